@@ -1,1261 +1,5360 @@
-#include <memory>
-#include <iostream>
-#include <vector>
-#include <cassert>
-#include <functional>
-#include <tuple>
-#include <limits>
-
-namespace avltree{
-	enum class tree_spec: int{
-		simple            = 0,
-		with_index        = 1 << 1,
-		with_depth        = 1 << 2,
-		pass_key_by_ref   = 1 << 3,
-		pass_key_by_val   = 1 << 4,
-		pass_value_by_ref = 1 << 5,
-		pass_value_by_val = 1 << 6,
-		max               = 1 << 7,
-	};
-	
-	inline constexpr tree_spec operator|(const tree_spec v1, const tree_spec v2){ return static_cast<tree_spec>(static_cast<int>(v1) | static_cast<int>(v2)); }
-	inline constexpr bool tree_spec_has(const tree_spec v1, const tree_spec v2){ return (static_cast<int>(v1) & static_cast<int>(v2)) != 0; }
-	
-	namespace avltree_base{
-		class empty{
-			empty() = delete;
-		};
-		template<typename K, typename V, tree_spec S, typename U = std::tuple<>> class avltree;
-	}
-	template<typename K, typename V, tree_spec S, typename U> class map;
-	template<typename V, tree_spec S, typename U> class multiset;
-	
-	namespace summarizer{
-		template<typename T> inline T pass(const T& d){ return d; }
-		template<typename D, typename T> inline T get_key(const D& d){ return d.first; }
-		template<typename D, typename T> inline T get_value(const D& d){ return d.second; }
-		
-		template<typename T> inline T add(const T& a, const T& b){ return a + b; }
-		template<typename T> inline T mul(const T& a, const T& b){ return a * b; }
-		template<typename T> inline T max(const T& a, const T& b){ return std::max(a, b); }
-		template<typename T> inline T min(const T& a, const T& b){ return std::min(a, b); }
-		
-		template<typename T> inline std::enable_if_t<std::is_arithmetic_v<T>, T> one(){ return 1; }
-		template<typename T> inline std::enable_if_t<std::is_arithmetic_v<T>, T> zero(){ return 0; }
-		template<typename T> inline std::enable_if_t<std::numeric_limits<T>::is_specialized, T> min_value(){ return std::numeric_limits<T>::min(); }
-		template<typename T> inline std::enable_if_t<std::numeric_limits<T>::is_specialized, T> max_value(){ return std::numeric_limits<T>::max(); }
-
-		template<typename U, typename T> using tuple_append = decltype(std::tuple_cat(std::declval<U>(), std::make_tuple(std::declval<T>())));
-		template<typename U, size_t I> struct summarizer_tuple_converter{
-			using tuple_type = tuple_append<typename summarizer_tuple_converter<U, I - 1>::tuple_type, typename std::tuple_element_t<I - 1, U>::type>;
-		};
-		template<typename U> struct summarizer_tuple_converter<U, 0>{
-			using tuple_type = std::tuple<>;
-		};
-		
-		template<typename K, typename V, tree_spec S, typename T, T summarize(const T& a, const T& b), T identity(), T get(const typename avltree_base::avltree<K, V, S>::data_type&) = pass<T>> struct single{
-			using data_type = typename avltree_base::avltree<K, V, S>::data_type;
-			using type = T;
-			inline static T get_(const data_type& d)          { return get(d); }
-			inline static T summarize_(const T& a, const T& b){ return summarize(a, b); }
-			inline static T identity_()                       { return identity(); }
-			inline static void accumulate_(T& a, const T& b)  { a = summarize(a, b); }
-		};
-		
-		template<typename K, typename V, tree_spec S, typename U> struct combined{
-			using data_type = typename avltree_base::avltree<K, V, S>::data_type;
-			using type = typename summarizer_tuple_converter<U, std::tuple_size_v<U>>::tuple_type;
-		private:
-			template<size_t I> static inline auto get__(const data_type& d){
-				const auto t = std::make_tuple(std::tuple_element_t<I, U>::get_(d));
-				if constexpr(I + 1 < std::tuple_size_v<U>){
-					return std::tuple_cat(t, get__<I + 1>(d));
-				}else{
-					return t;
-				}
-			}
-			template<size_t I> static inline auto summarize__(const type& a, const type& b){
-				const auto t = std::make_tuple(std::tuple_element_t<I, U>::summarize_(std::get<I>(a), std::get<I>(b)));
-				if constexpr(I + 1 < std::tuple_size_v<U>){
-					return std::tuple_cat(t, summarize__<I + 1>(a, b));
-				}else{
-					return t;
-				}
-			}
-			template<size_t I> static inline auto identity__(){
-				const auto t = std::make_tuple(std::tuple_element_t<I, U>::identity_());
-				if constexpr(I + 1 < std::tuple_size_v<U>){
-					return std::tuple_cat(t, identity__<I + 1>());
-				}else{
-					return t;
-				}
-			}
-		public:
-			static inline type get_(const data_type& d){ return get__<0>(d); }
-			static inline type summerize_(const type& a, const type& b){ return summarize__<0>(a, b); }
-			static inline type identity_(){ return identity__<0>(); }
-			static inline void accumulate_(type& a, const type& b){ a = summarize__<0>(a, b); }
-		};
-
-		template<typename K, typename V, tree_spec S, typename U> using tuple_to_summarizer = 
-			std::conditional_t<std::tuple_size_v<U> == 0, avltree_base::empty, 
-			std::conditional_t<std::tuple_size_v<U> == 1, std::tuple_element_t<0, tuple_append<U, int>>, // to avoid error caused by std::tuple_element<0, tuple<>>
-					combined<K, V, S, U>>>;
-	}
-	
-	namespace avltree_base{
-		template<typename I, typename O, typename T, T F(O)> class iterator_wrapper{
-			I i;
-		public:
-			inline iterator_wrapper(I&& i_): i(std::move(i_)){}
-			template<typename E> inline bool operator==(const E& e) const { return i == e; };
-			template<typename E> inline bool operator!=(const E& e) const { return i != e; };
-			template<typename E> friend inline bool operator==(const E& e, const iterator_wrapper& i) { return e == i.i; };
-			template<typename E> friend inline bool operator!=(const E& e, const iterator_wrapper& i) { return e != i.i; };
-			inline T operator*() const { return F(*i); };
-			inline iterator_wrapper& operator++(){ ++ i; return *this; }
-			inline iterator_wrapper& operator--(){ -- i; return *this; }
-			inline iterator_wrapper operator++(int){ auto _i = *this; i.i ++; return _i; }
-			inline iterator_wrapper operator--(int){ auto _i = *this; i.i --; return _i; }
-		};
-		
-		template<typename B, typename E> class iterator_pair{
-			const B b;
-			const E e;
-		public:
-			inline iterator_pair(B&& b_, E&& e_): b(std::move(b_)), e(std::move(e_)){}
-			inline auto begin(){ return b(); }
-			inline auto end(){ return e(); }
-		};
-		
-		template <size_t N = 0, typename... T> static std::string to_string(const std::tuple<T...>& v){
-			std::string result = "";
-			if constexpr(N == 0){
-				result += "(";
-			}
-			result += to_string(std::get<N>(v));
-			if constexpr(N == sizeof...(T) - 1){
-				result += ")";
-			}else{
-				result += "," + to_string<N + 1, T...>(v);
-			}
-			return result;
-		}
-		
-		template <typename T> static std::string to_string(const T& v){
-			return std::to_string(v);
-		}
-		
-
-		template<typename K, typename V, tree_spec S, typename U> class avltree{
-			friend class ::avltree::multiset<K, S, U>;
-#ifdef AVLTREE_DEBUG_CLASS
-				friend class AVLTREE_DEBUG_CLASS;
-#endif
-			static_assert(!tree_spec_has(S, tree_spec::max), "invalid tree_spec");
-			static_assert(!(tree_spec_has(S, tree_spec::pass_key_by_ref) && tree_spec_has(S, tree_spec::pass_key_by_val)), "invalid tree_spec: both flags passing key by reference and value cannot be specified at same time");
-			static_assert(!(tree_spec_has(S, tree_spec::pass_value_by_ref) && tree_spec_has(S, tree_spec::pass_value_by_val)), "invalid tree_spec: both flags passing value by reference and value cannot be specified at same time");
-			avltree() = delete;
-		public:
-			using with_depth    = std::conditional_t<tree_spec_has(S, tree_spec::with_depth), std::true_type, std::false_type>;
-			using with_index    = std::conditional_t<tree_spec_has(S, tree_spec::with_index), std::true_type, std::false_type>;
-			using with_summary  = std::negation<std::is_same<U, std::tuple<>>>;
-			using with_value    = std::negation<std::is_same<V, empty>>;
-			
-			using use_ref_k = std::bool_constant<(tree_spec_has(S, tree_spec::pass_key_by_ref) || (!tree_spec_has(S, tree_spec::pass_key_by_val) && sizeof(std::tuple<K>) > sizeof(std::nullptr_t)))>;
-			using use_ref_v = std::bool_constant<(tree_spec_has(S, tree_spec::pass_value_by_ref) || (!tree_spec_has(S, tree_spec::pass_value_by_val) && sizeof(std::tuple<V>) > sizeof(std::nullptr_t)))>;
-			
-			using KR = std::conditional_t<use_ref_k::value, const K&, const K>;
-			using VR = std::conditional_t<use_ref_v::value, const V&, const V>;
-			
-			using data_type = std::conditional_t<with_value::value, std::pair<K, V>, K>;
-
-		private:
-			class node_with_value;
-			class node_without_value;
-			using node = std::conditional_t<with_value::value, node_with_value, node_without_value>;
-			using node_uptr = std::unique_ptr<node>;
-		private:
-			static std::string node_to_string(const node& node){
-				std::string ret = "(" + avltree_base::to_string(node.key());
-				
-				if constexpr(with_index::value){
-					ret += ", c=" + avltree_base::to_string(node.c);
-				}
-				if constexpr(with_depth::value){
-					ret += ", h=" + avltree_base::to_string(node.h);
-				}else{
-					ret += ", b=" + avltree_base::to_string(node.balance());
-				}
-				
-				ret += ")";
-				if constexpr(with_value::value){
-					ret += "-> " + avltree_base::to_string(node.value());
-				}
-				
-				return ret;
-			}
-			static void print_node(const node& node, bool top, std::string indent, bool lr_flag){
-				if(node.l){
-					print_node(*node.l, false, top ? "" : indent + (lr_flag ? "   " : "  |"), true);
-				}
-				
-				if(top){
-					std::cout << "-" << node_to_string(node) << std::endl;
-					if(node.r){
-						std::cout << "  |" << std::endl;
-					}
-				}else{
-					std::cout << indent << "  +" << node_to_string(node) << std::endl;
-					
-					if(lr_flag || node.r || indent.find("|") != std::string::npos){
-						std::cout << indent;
-						if(lr_flag && node.r){
-							std::cout << "  |  |" << std::endl;
-						}else if(lr_flag){
-							std::cout << "  |" << std::endl;
-						}else if(node.r){
-							std::cout << "     |" << std::endl;
-						}else{
-							std::cout << std::endl;
-						}
-					}
-				}
-				if(node.r){
-					print_node(*node.r, false, top ? "" : indent + (lr_flag ? "  |" : "   "), false);
-				}
-			}
-			
-			/*
-				NODE BASE : node_base0
-			*/
-			
-			struct node_base0{
-				std::unique_ptr<node> l, r;
-			protected:
-				inline node_base0() : l(), r() {}
-			};
-			
-			/*
-				WITH BALANCE or DEPTH : node_base1
-			*/
-			
-			struct node_with_balance: public node_base0{
-				int b;
-				inline int balance() const { return b; }
-			protected:
-				inline node_with_balance(): node_base0(), b(0) {}
-			};
-			
-			struct node_with_depth: public node_base0{
-				int h;
-				inline int depth_l() const { return this->l ? this->l->h : 0; }
-				inline int depth_r() const { return this->r ? this->r->h : 0; }
-				inline void reset_depth(){
-					h = std::max(depth_l(), depth_r()) + 1;
-				}
-				inline int balance() const { return depth_l() - depth_r(); }
-			protected:
-				inline node_with_depth(): node_base0(), h(1) {}
-			};
-			
-			using node_base1 = std::conditional_t<with_depth::value, node_with_depth, node_with_balance>;
-			
-			/*
-				WITH COUNT(INDEX) or not : node_base2
-			*/
-			
-			struct node_with_count : public node_base1{
-				size_t c;
-			protected:
-				inline node_with_count() : node_base1(), c(1) {}
-			public:
-				inline void update_count(){
-					const auto cl = this->l ? this->l->c : 0;
-					const auto cr = this->r ? this->r->c : 0;
-					c = cl + cr + 1;
-				}
-			};
-			
-			using node_base2 = std::conditional_t<with_index::value, node_with_count, node_base1>;
-			
-			/*
-				WITH VALUE or not : node_base3
-			*/
-			
-			struct node_base_with_value : public node_base2{
-				data_type data;
-				inline KR key() const { return data.first; }
-				inline K& key(){ return data.first; }
-				inline VR value() const{ return data.second; }
-				inline V& value(){ return data.second; }
-				inline node_base_with_value(data_type&& data_): data(std::move(data_)){}
-			};
-			struct node_base_without_value : public node_base2{
-				data_type data;
-				inline KR key() const { return data; }
-				inline K& key(){ return data; }
-				inline node_base_without_value(data_type&& data_): data(std::move(data_)){}
-			};
-			
-			using node_base3 = std::conditional_t<with_value::value, node_base_with_value, node_base_without_value>;
-			
-			/*
-				WITH SUMMARY or not : node_base4
-			*/
-			
-			using summarizer = summarizer::tuple_to_summarizer<K, V, S, U>;
-			
-			struct node_with_summary : public node_base3{
-				typename summarizer::type s;
-			protected:
-				node_with_summary(data_type&& data_): node_base3(std::move(data_)), s(summarizer::identity_())/*, k_min(nullptr), k_max(nullptr)*/{ update_summary(); }
-			public:
-				inline void update_summary(){
-					s = summarizer::get_(this->data);
-					if(this->l){
-						summarizer::accumulate_(s, this->l->s);
-					}
-					if(this->r){
-						summarizer::accumulate_(s, this->r->s);
-					}
-				}
-			};
-			
-			using node_base4 = std::conditional_t<with_summary::value, node_with_summary, node_base3>;
-			
-			/*
-				WITH VALUE or not
-			*/
-			
-			struct node_with_value: node_base4{
-				inline node_with_value(const K& k, const V&  v): node_base4(data_type(k, v)){}
-				inline node_with_value(const K& k, V&& v):       node_base4(data_type(k, std::move(v))){}
-				inline node_with_value(K&& k, const V&  v):      node_base4(data_type(std::move(k), v)){}
-				inline node_with_value(K&& k, V&& v):            node_base4(data_type(std::move(k), std::move(v))){}
-				inline void print() const{ print_node(*this, true, "", true); }
-			};
-			
-			struct node_without_value: node_base4{
-				inline node_without_value(const K& k): node_base4(data_type(k)){}
-				inline node_without_value(K&& k):      node_base4(data_type(std::move(k))){}
-				inline void print() const{ print_node(*this, true, "", true); }
-			};
-			
-			template<typename N> struct node_view_base0{
-			protected:
-				N n;
-				inline node_view_base0(const N& _n): n(_n){}
-				inline node_view_base0(N&& _n): n(std::move(_n)){}
-			public:
-				inline operator bool() const { return n != nullptr; }
-				inline bool operator==(std::nullptr_t n) const { return !*this; }
-				inline const data_type& operator*() const& { return n->data; }
-				inline const data_type operator*() && { return std::move(n->data); }
-				inline data_type const* operator->() const& { return &n->data; }
-			};
-			
-			template<typename N> struct node_view_with_count: public node_view_base0<N>{
-			protected:
-				inline node_view_with_count(const N& n_): node_view_base0<N>(n_){}
-				inline node_view_with_count(N&& n_): node_view_base0<N>(std::move(n_)){}
-			public:
-				inline size_t size() const { return this->n->count; }
-			};
-			
-			template<typename N> using node_view_base1 = std::conditional_t<with_index::value, node_view_with_count<N>, node_view_base0<N>>;
-			
-			template<typename N> struct node_view_with_depth: public node_view_base1<N>{
-			protected:
-				inline node_view_with_depth(const N& n_): node_view_base1<N>(n_){}
-				inline node_view_with_depth(N&& n_): node_view_base1<N>(std::move(n_)){}
-			public:
-				inline size_t height() const { return this->n->h; }
-			};
-			
-			template<typename N> using node_view_base2 = std::conditional_t<with_depth::value, node_view_with_depth<N>, node_view_base1<N>>;
-			
-		public:
-			class node_view: public node_view_base2<const node*>{
-			public:
-				inline explicit node_view(const node* n_): node_view_base2<const node*>(n_){}
-				inline explicit node_view(const node_uptr& n_): node_view_base2<const node*>(n_.get()){};
-				inline friend bool operator==(std::nullptr_t p, const node_view& n) { return !n; }
-			};
-			
-			class node_uptr_view: public node_view_base2<node_uptr>{
-			public:
-				inline explicit node_uptr_view(node_uptr&& n_): node_view_base2<node_uptr>(std::move(n_)){}
-				inline friend bool operator==(std::nullptr_t p, const node_uptr_view& n) { return !n; }
-			};
-			
-		private:
-			using branch_func = std::function<int(const node&)>;
-			
-			template<bool L2R = true> class iterator_base: public node_view{
-				std::vector<const node*> _stack;
-				int _depth;
-				const node* cur() const { return this->n; }
-				const node* &cur(){ return this->n; }
-				template<bool F> inline void _down_to_leaf(){
-					while(true){
-						const auto& c = (L2R ^ !F) ? cur()->l : cur()->r;
-						if(!c){
-							break;
-						}
-						_stack[_depth] = cur();
-						_depth ++;
-						cur() = c.get();
-					}
-				}
-				template<bool F> inline void _forward(){
-					const auto& c = (L2R ^ !F) ? cur()->r : cur()->l;
-					if(c){
-						_stack[_depth] = cur();
-						_depth ++;
-						cur() = c.get();
-						_down_to_leaf<F>();
-					}else{
-						while(true){
-							if(_depth > 0){
-								auto child = cur();
-								_depth --;
-								cur() = _stack[_depth];
-								if(((L2R ^ !F) ? cur()->l.get() : cur()->r.get()) == child){
-									break;
-								}
-							}else{
-								cur() = nullptr;
-								break;
-							}
-						}
-					}
-				}
-			public:
-				inline iterator_base(size_t stack_size, const node* root, const bool D = true) : _stack(stack_size), _depth(0), node_view(root){
-					if(cur()){
-						if(D){
-							_down_to_leaf<true>();
-						}else{
-							_down_to_leaf<false>();
-						}
-					}
-				}
-				inline iterator_base(size_t stack_size, const node* root, branch_func branch) : _stack(stack_size), _depth(0), node_view(root){
-					while(cur()){
-						const int b = branch(*cur());
-						if(b == 0){
-							break;
-						}else if(b == -1){
-							cur() = cur()->l.get();
-						}else{
-							cur() = cur()->r.get();
-						}
-					}
-				}
-				inline bool operator==(std::nullptr_t _) const{ return cur() == nullptr; }
-				inline bool operator!=(std::nullptr_t _) const{ return cur() != nullptr; }
-				inline iterator_base& operator++(){ _forward<true>(); return *this;}
-				inline iterator_base& operator--(){ _forward<false>(); return *this; }
-				inline iterator_base operator++(int){ auto i = *this; ++*this; return i; }
-				inline iterator_base operator--(int){ auto i = *this; --*this; return i; }
-			};
-			
-			class tree_base0{
-			protected:
-				tree_base0() : root(), stack(){
-					this->stack.push_back(nullptr);
-				}
-				inline static int _branch_eq(const node& cur, KR k){ return cur.key() == k ? 0 : (k < cur.key() ? -1 : 1); }
-				inline static branch_func _make_branch_eq(KR k){
-					if constexpr(use_ref_k::value){
-						return [&k](const node& cur){ return _branch_eq(cur, k); };
-					}else{
-						return [k](const node& cur){ return _branch_eq(cur, k); };
-					}
-				}
-				inline static int _branch_ge(const node& cur, const node*& cand, KR k){
-					if(k <= cur.key() && (!cand || cur.key() < cand->key())){
-						cand = &cur;
-					}
-					return _branch_eq(cur, k);
-				}
-				inline static int _branch_le(const node& cur, const node*& cand, KR k){
-					if(cur.key() <= k && (!cand || cand->key() < cur.key())){
-						cand = &cur;
-					}
-					return _branch_eq(cur, k);
-				}
-				inline static int _branch_gt(const node& cur, const node*& cand, KR k){
-					if(k < cur.key()){
-						if(!cand || cur.key() < cand->key()){
-							cand = &cur;
-						}
-						return -1;
-					}else{
-						return 1;
-					}
-				}
-				inline static int _branch_lt(const node& cur, const node*& cand, KR k){
-					if(cur.key() < k){
-						if(!cand || cand->key() < cur.key()){
-							cand = &cur;
-						}
-						return 1;
-					}else{
-						return -1;
-					}
-				}
-				template<int B(const node&, const node*&, KR)> inline static branch_func _make_branch_find_func(const node*& cand, KR k){
-					if constexpr(use_ref_k::value){
-						return [&cand, &k](const node& cur){ return B(cur, cand, k); };
-					}else{
-						return [&cand, k](const node& cur){ return B(cur, cand, k); };
-					}
-				}
-				inline static branch_func _make_branch_l(){ return [](const node& cur){ return cur.l ? -1 : (cur.r ? 1 : 0); }; }
-				inline static branch_func _make_branch_r(){ return [](const node& cur){ return cur.r ? 1 : (cur.l ? -1 : 0); }; }
-				inline static branch_func _make_branch_at(size_t& index){
-					return [&index](const node& cur){
-						const auto count_l = cur.l ? cur.l->c : 0;
-						if(index == count_l){
-							return 0;
-						}else if(index < count_l){
-							return -1;
-						}else{
-							index -= count_l + 1;
-							return 1;
-						}
-					};
-				}
-				template <int B(const node&, KR)> inline static branch_func _make_branch_calc_index(size_t& index, KR k){
-					return [&index, k](const node& cur){
-						const auto b = B(cur, k);
-						if(b >= 0){
-							if(cur.l){
-								index += cur.l->c;
-							}
-							if(b == 1){
-								index += 1;
-							}
-						}
-						return b;
-					};
-				}
-				
-				node_uptr root;
-				std::vector<node_uptr*> stack;
-			
-				inline std::tuple<node_uptr&, size_t> _find(branch_func branch){
-					node_uptr* cur = &this->root;
-					size_t height = 0;
-					while(*cur){
-						const auto b = branch(**cur);
-						if(b == 0){
-							break;
-						}
-						this->stack[height] = cur;
-						height ++;
-						if(b < 0){
-							cur = &(*cur)->l;
-						}else{
-							cur = &(*cur)->r;
-						}
-					}
-					return std::tuple_cat(std::tie(*cur), std::make_tuple(height));
-				}
-			
-				inline const node* _find(branch_func branch) const{
-					const node* cur = this->root.get();
-					while(cur){
-						const auto b = branch(*cur);
-						if(b == 0){
-							break;
-						}else if(b < 0){
-							cur = cur->l.get();
-						}else{
-							cur = cur->r.get();
-						}
-					}
-					return cur;
-				}
-				
-				template<int B(const node&, const node*&, KR)> inline const node* _find_nearest(KR k) const{
-					const node* cand = nullptr;
-					this->_find(tree_base0::template _make_branch_find_func<B>(cand, k));
-					return cand;
-				}
-				
-#ifdef AVLTREE_DEBUG_CLASS
-				friend class AVLTREE_DEBUG_CLASS;
-#endif
-			};
-			
-			class tree_base_without_index : public tree_base0{
-			protected:
-				size_t _count;
-				tree_base_without_index() : tree_base0(), _count(0){}
-			public:
-				size_t size() const{ return _count; }
-			};
-			
-		public:
-			using iterator         = avltree<K, V, S, U>::iterator_base<true>;
-			using reverse_iterator = avltree<K, V, S, U>::iterator_base<false>;
-		private:
-			class tree_base_with_index : public tree_base0{
-			protected:
-				tree_base_with_index() : tree_base0(){}
-			public:
-				inline size_t size() const{ return this->root ? this->root->c : 0; }
-				
-				inline const node_view at(size_t index) const{ return node_view(this->_find(tree_base0::_make_branch_at(index))); }
-				inline node_uptr_view pop_at(size_t index){ return node_uptr_view(_pop(tree_base0::_make_branch_at(index))); }
-				inline iterator iterator_at(size_t index) const{ return iterator(this->stack.size(), this->root.get(), tree_base0::_make_branch_at(index)); }
-				
-				inline size_t index(KR k) const{
-					size_t index = 0;
-					if(this->_find(tree_base0::template _make_branch_calc_index<tree_base0::_branch_eq>(index, k))){
-						return index;
-					}else{
-						return size();
-					}
-				}
-				
-				template<int B(const node&, const node*&, KR)> inline std::tuple<const node_view, size_t> _find_nearest_with_index(KR k) const {
-					const node* cand = nullptr;
-					size_t index = this->size(), index_tmp = 0;
-					const auto branch_base = tree_base0::template _make_branch_find_func<B>(cand, k);
-					const auto branch = [&index, &index_tmp, &cand, branch_base](const node& cur){
-						const int b = branch_base(cur);
-						if(&cur == cand){
-							index = index_tmp + (cur.l ? cur.l->c : 0);
-						}
-						if(b >= 1){
-							index_tmp += cur.l ? cur.l->c : 0;
-							if(b == 1){
-								index_tmp += 1;
-							}
-						}
-						return b;
-					};
-					this->_find(branch);
-					return std::make_tuple(node_view(cand), index);
-				}
-				
-				inline std::tuple<const node_view, size_t> find_ge_with_index(KR k) const{ return _find_nearest_with_index<tree_base0::_branch_ge>(k); }
-				inline std::tuple<const node_view, size_t> find_gt_with_index(KR k) const{ return _find_nearest_with_index<tree_base0::_branch_gt>(k); }
-				inline std::tuple<const node_view, size_t> find_le_with_index(KR k) const{ return _find_nearest_with_index<tree_base0::_branch_le>(k); }
-				inline std::tuple<const node_view, size_t> find_lt_with_index(KR k) const{ return _find_nearest_with_index<tree_base0::_branch_lt>(k); }
-			};
-			
-			using tree_base1 = std::conditional_t<with_index::value, tree_base_with_index, tree_base_without_index>;
-
-		public:
-			
-			class tree_base2 : public tree_base1{
-				template<node_uptr& L(node&), node_uptr& R(node&), int D> inline void _rotate(node_uptr& p1){
-					node_uptr& p2 = L(*p1);
-					node_uptr& p3 = R(*p2);
-					if(p2->balance() == -D){
-						node_uptr& p4 = L(*p3);
-						node_uptr& p5 = R(*p3);
-						const auto p3b = p3->balance();
-						swap(p1, p3);
-						swap(p2, p5);
-						swap(p3, p4);
-						swap(p4, p5);
-						if constexpr(with_depth::value){
-							p4->reset_depth();
-							p5->reset_depth();
-							p1->reset_depth();
-						}else{
-							p1->b = 0;
-							if(p3b == 0){
-								p4->b = 0;
-								p5->b = 0;
-							}else if(p3b == D){
-								p4->b = 0;
-								p5->b = -D;
-							}else{
-								p4->b = D;
-								p5->b = 0;
-							}
-						}
-						if constexpr(with_index::value){
-							p4->update_count();
-							p5->update_count();
-							p1->update_count();
-						}
-						if constexpr(with_summary::value){
-							p4->update_summary();
-							p5->update_summary();
-							p1->update_summary();
-						}
-					}else{
-						swap(p1, p2);
-						swap(p2, p3);
-						if constexpr(with_depth::value){
-							p3->reset_depth();
-							p1->reset_depth();
-						}else{
-							p1->b -= D;
-							if(p1->b == 0){
-								p3->b = 0;
-							}else{
-								p3->b = D;
-							}
-						}
-						if constexpr(with_index::value){
-							p3->update_count();
-							p1->update_count();
-						}
-						if constexpr(with_summary::value){
-							p3->update_summary();
-							p1->update_summary();
-						}
-					}
-				}
-				
-				inline static node_uptr& get_l(node& node){ return node.l; }
-				inline static node_uptr& get_r(node& node){ return node.r; }
-				inline void _rotate_lr(node_uptr& p1){ _rotate<get_l, get_r, 1>(p1); }
-				inline void _rotate_rl(node_uptr& p1){ _rotate<get_r, get_l, -1>(p1); }
-			protected:
-				template <typename K_> inline bool _insert(K_&& k){
-					auto [new_node, height] = this->_find(tree_base0::_make_branch_eq(k));
-					if(new_node){
-						return false;
-					}
-					new_node = std::make_unique<node>(std::forward<K_>(k));
-					_fix_balance<1>(new_node, height);
-					return true;
-				}
-				template <typename K_, typename V_> inline bool _insert(K_&& k, V_&& v){
-					auto [new_node, height] = this->_find(tree_base0::_make_branch_eq(k));
-					if(new_node){
-						new_node->value() = std::forward<V_>(v);
-						if constexpr(with_summary::value){
-							new_node->update_summary();
-							while(height != 0){
-								height --;
-								(*this->stack[height])->update_summary();
-							}
-						}
-						return false;
-					}
-					new_node = std::make_unique<node>(std::forward<K_>(k), std::forward<V_>(v));
-					_fix_balance<1>(new_node, height);
-					return true;
-				}
-				node_uptr _pop(branch_func branch){
-					auto [node, height] = this->_find(branch);
-					node_uptr* cur = &node;
-					node_uptr release = nullptr;
-					if(*cur){
-						node_uptr& n = *cur;
-						if(n->l){
-							if(n->r){
-								auto get_f = n->balance() >= 0 ? get_l : get_r;
-								auto get_b = n->balance() >= 0 ? get_r : get_l;
-								this->stack[height] = cur;
-								height ++;
-								cur = &get_f(**cur);
-								while(get_b(**cur)){
-									this->stack[height] = cur;
-									height ++;
-									cur = &get_b(**cur);
-								}
-								n->key() = std::move((*cur)->key());
-								if constexpr(with_value::value){
-									n->value() = std::move((*cur)->value());
-								}
-								std::swap(release, get_f(**cur));
-								std::swap(*cur, release);
-							}else{
-								std::swap(release, n->l);
-								std::swap(n, release);
-							}
-						}else{
-							std::swap(release, n->r);
-							std::swap(n, release);
-						}
-						if(height > 0){
-							_fix_balance<-1>(*cur, height);
-						}else{
-							if constexpr(!with_index::value){
-								this->_count --;
-							}
-						}
-					}
-					return release;
-				}
-				
-				template<int D> inline void _fix_balance(node_uptr& cur, size_t height){
-					node_uptr* child = &cur;
-					if constexpr(!with_index::value){
-						this->_count += D;
-					}
-					const auto max_depth = height;
-					while(height > 0){
-						height --;
-						node_uptr* parent_ptr = this->stack[height];
-						node& parent = **parent_ptr;
-						if constexpr(with_index::value){
-							parent.c += D;
-						}
-						if constexpr(with_depth::value){
-							parent.reset_depth();
-						}else{
-							if constexpr(with_summary::value){
-								parent.update_summary();
-							}
-							if(&parent.l == child){
-								parent.b += D;
-							}else{
-								parent.b -= D;
-							}
-						}
-						if(parent.balance() == 2){
-							_rotate_lr(*parent_ptr);
-							if constexpr(D == 1){
-								break;
-							}else{
-								if((*parent_ptr)->balance() != 0){
-									break;
-								}
-							}
-						}else if(parent.balance() == -2){
-							_rotate_rl(*parent_ptr);
-							if constexpr(D == 1){
-								break;
-							}else{
-								if((*parent_ptr)->balance() != 0){
-									break;
-								}
-							}
-						}else if(parent.balance() == 0){
-							if constexpr(D == 1){
-								break;
-							}
-						}else{
-							if constexpr(D != 1){
-								break;
-							}
-						}
-						child = parent_ptr;
-					}
-					if(height == 0){
-						if constexpr(D == 1){
-							if(this->stack.size() <= max_depth){
-								this->stack.push_back(nullptr);
-							}
-						}
-					}else{
-						if constexpr(with_depth::value || with_index::value || with_summary::value){
-							while(height > 0){
-								height --;
-								node_uptr* parent_ptr = this->stack[height];
-								node& parent = **parent_ptr;
-								if constexpr(with_index::value){
-									parent.c += D;
-								}
-								if constexpr(with_depth::value){
-									parent.reset_depth();
-								}
-								if constexpr(with_summary::value){
-									parent.update_summary();
-								}
-								child = parent_ptr;
-							}
-						}
-					}
-				}
-				
-				tree_base2() : tree_base1(){};
-			public:
-				node_uptr_view remove(KR k){ return node_uptr_view(_pop(tree_base0::_make_branch_eq(k))); }
-				node_uptr_view pop_first() { return node_uptr_view(_pop(tree_base0::_make_branch_l())); }
-				node_uptr_view pop_last()  { return node_uptr_view(_pop(tree_base0::_make_branch_r())); }
-				
-				bool contains(KR k) const{ return this->_find(tree_base0::_make_branch_eq(k)) != nullptr; }
-				
-				void print(){
-					if(this->root){
-						this->root->print();
-					}
-				}
-				
-				inline const node_view find(KR k) const{ return node_view(this->_find(tree_base0::_make_branch_eq(k))); }
-				inline const iterator iterator_find(KR k) const{ return iterator(this->stack.size(), this->root.get(), tree_base0::_make_branch_eq(k)); }
-				
-				inline const node_view find_ge(KR k) const{ return node_view(this->template _find_nearest<tree_base0::_branch_ge>(k)); }
-				inline const node_view find_gt(KR k) const{ return node_view(this->template _find_nearest<tree_base0::_branch_gt>(k)); }
-				inline const node_view find_le(KR k) const{ return node_view(this->template _find_nearest<tree_base0::_branch_le>(k)); }
-				inline const node_view find_lt(KR k) const{ return node_view(this->template _find_nearest<tree_base0::_branch_lt>(k)); }
-				
-				inline iterator begin() const{ return iterator(this->stack.size(), this->root.get()); }
-				inline iterator last() const{ return iterator(this->stack.size(), this->root.get(), false); }
-				inline reverse_iterator rbegin() const{ return reverse_iterator(this->stack.size(), this->root.get()); }
-				inline reverse_iterator rlast() const{ return reverse_iterator(this->stack.size(), this->root.get(), false); }
-				inline std::nullptr_t end() const{ return nullptr; }
-				inline std::nullptr_t rend() const{ return end(); }
-				
-#ifdef AVLTREE_DEBUG_CLASS
-				friend class AVLTREE_DEBUG_CLASS;
-#endif
-			};
-			
-			class tree_base_with_summary: public tree_base2{
-			private:
-				typename summarizer::type summarize_(const node& cur, KR l, KR r){
-					typename summarizer::type summary(summarizer::identity_());
-					if(cur.l && l <= cur.key()){
-						if(r >= cur.key()){
-							summarizer::accumulate_(summary, summarize_l_(*cur.l, l));
-						}else{
-							summarizer::accumulate_(summary, summarize_(*cur.l, l, r));
-						}
-					}
-					if(l <= cur.key() && r >= cur.key()){
-						summarizer::accumulate_(summary, summarizer::get_(cur.data));
-					}
-					if(cur.r && r >= cur.key()){
-						if(l <= cur.key()){
-							summarizer::accumulate_(summary, summarize_r_(*cur.r, r));
-						}else{
-							summarizer::accumulate_(summary, summarize_(*cur.r, l, r));
-						}
-					}
-					return summary;
-				}
-				typename summarizer::type summarize_l_(const node& cur, KR l){
-					if(l > cur.key()){
-						if(cur.r){
-							return summarize_l_(*cur.r, l);
-						}else{
-							return summarizer::identity_();
-						}
-					}else{
-						typename summarizer::type summary(summarizer::get_(cur.data));
-						if(cur.l){
-							summarizer::accumulate_(summary, summarize_l_(*cur.l, l));
-						}
-						if(cur.r){
-							summarizer::accumulate_(summary, cur.r->s);
-						}
-						return summary;
-					}
-				}
-				typename summarizer::type summarize_r_(const node& cur, KR r){
-					if(r < cur.key()){
-						if(cur.l){
-							return summarize_r_(*cur.l, r);
-						}else{
-							return summarizer::identity_();
-						}
-					}else{
-						typename summarizer::type summary(summarizer::get_(cur.data));
-						if(cur.r){
-							summarizer::accumulate_(summary, summarize_r_(*cur.r, r));
-						}
-						if(cur.l){
-							summarizer::accumulate_(summary, cur.l->s);
-						}
-						return summary;
-					}
-				}
-			public:
-				tree_base_with_summary(): tree_base2(){}
-				inline typename summarizer::type summarize(KR l, KR r){
-					if(this->root){
-						return summarize_(*this->root, l, r);
-					}else{
-						return summarizer::identity_();
-					}
-				}
-				inline typename summarizer::type summarize(const node_view& l, const node_view& r){
-					return summarize(*l, *r);
-				}
-			};
-			
-			class tree_base_with_summary_and_index: public tree_base_with_summary{
-				typename summarizer::type summarize_by_index_(const node& cur, size_t l, size_t r){
-					if(l >= r){
-						return summarizer::identity_();
-					}else if(l == 0 && r >= cur.c){
-						return cur.s;
-					}else{
-						typename summarizer::type summary(summarizer::identity_());
-						size_t cl;
-						if(cur.l){
-							cl = cur.l->c;
-							if(l < cl){
-								summarizer::accumulate_(summary, summarize_by_index_(*cur.l, l, r));
-							}
-						}else{
-							cl = 0;
-						}
-						if(l <= cl && r >= cl + 1){
-							summarizer::accumulate_(summary, summarizer::get_(cur.data));
-						}
-						if(cur.r){
-							if(r > cl + 1){
-								summarizer::accumulate_(summary, summarize_by_index_(*cur.r, l > cl + 1 ? l - cl - 1 : 0, r - cl - 1));
-							}
-						}
-						return summary;
-					}
-				}
-			public:
-				tree_base_with_summary_and_index(): tree_base_with_summary(){}
-				typename summarizer::type summarize_by_index(size_t l, size_t r){
-					if(this->root){
-						return summarize_by_index_(*this->root, l, r);
-					}else{
-						return summarizer::identity_();
-					}
-				}
-			};
-			
-			using tree_base = std::conditional_t<with_summary::value, std::conditional_t<with_index::value, tree_base_with_summary_and_index, tree_base_with_summary>, tree_base2>;
-			
-			
-			class multiset_base0: public tree_base{
-				inline static int _branch_eq(const node& cur, KR k){
-					if(cur.key() == k){
-						return cur.balance() > 0 ? 1 : -1;
-					}else{
-						return k < cur.key() ? -1 : 1;
-					}
-				}
-				inline static branch_func _make_branch_eq(KR k){
-					if constexpr(use_ref_k::value){
-						return [&k](const node& cur){ return _branch_eq(cur, k); };
-					}else{
-						return [k](const node& cur){ return _branch_eq(cur, k); };
-					}
-				}
-			protected:
-				multiset_base0(): tree_base(){}
-			public:
-				template<typename V_> bool insert(V_&& v){
-					auto [new_node, height] = this->_find(_make_branch_eq(v));
-					new_node = std::make_unique<node>(std::forward<V_>(v));
-					this->template _fix_balance<1>(new_node, height);
-					return true;
-				}
-			};
-			
-			class multiset_with_index: public multiset_base0{
-				template<int D> inline static int _branch_index(size_t& index, size_t& index_tmp, const node& cur, KR k){
-					if(cur.key() == k){
-						index = index_tmp + (cur.l ? cur.l->c : 0);
-						if(D == 1){
-							index_tmp += (cur.l ? cur.l->c : 0) + 1;
-							return 1;
-						}else{
-							return -1;
-						}
-					}else if(k < cur.key()){
-						return -1;
-					}else{
-						index_tmp += (cur.l ? cur.l->c : 0) + 1;
-						return 1;
-					}
-				}
-				inline static int _branch_ge(const node& cur, const node*& cand, KR k){
-					if(k <= cur.key() && (!cand || cur.key() <= cand->key())){
-						cand = &cur;
-					}
-					if(cur.key() < k){
-						return 1;
-					}else{
-						return -1;
-					}
-				}
-				inline static int _branch_le(const node& cur, const node*& cand, KR k){
-					if(cur.key() <= k && (!cand || cand->key() <= cur.key())){
-						cand = &cur;
-					}
-					if(k < cur.key()){
-						return -1;
-					}else{
-						return 1;
-					}
-				}
-				inline static int _branch_gt(const node& cur, const node*& cand, KR k){
-					if(k < cur.key()){
-						if(!cand || cur.key() <= cand->key()){
-							cand = &cur;
-						}
-						return -1;
-					}else{
-						return 1;
-					}
-				}
-				inline static int _branch_lt(const node& cur, const node*& cand, KR k){
-					if(cur.key() < k){
-						if(!cand || cand->key() <= cur.key()){
-							cand = &cur;
-						}
-						return 1;
-					}else{
-						return -1;
-					}
-				}
-				template<int D> inline size_t _index(KR k) const{
-					size_t index = this->size(), index_tmp = 0;
-					if constexpr(use_ref_k::value){
-						this->_find([&k, &index, &index_tmp](const node&cur){ return _branch_index<D>(index, index_tmp, cur, k); });
-					}else{
-						this->_find([k, &index, &index_tmp](const node&cur){ return _branch_index<D>(index, index_tmp, cur, k); });
-					}
-					return index;
-				}
-			protected:
-				multiset_with_index(): multiset_base0(){}
-			public:
-				inline size_t index(KR k) const{ return this->_index<-1>(k); }
-				inline size_t last_index(KR k) const{ return this->_index<1>(k); }
-				inline size_t count(KR k) const{
-					size_t first = index(k);
-					if(first == this->size()){
-						return 0;
-					}else{
-						return last_index(k) - first + 1;
-					}
-				}
-				inline std::tuple<const node_view, size_t> find_ge_with_index(KR k) const{ return this->template _find_nearest_with_index<_branch_ge>(k); }
-				inline std::tuple<const node_view, size_t> find_le_with_index(KR k) const{ return this->template _find_nearest_with_index<_branch_le>(k); }
-				inline std::tuple<const node_view, size_t> find_gt_with_index(KR k) const{ return this->template _find_nearest_with_index<_branch_gt>(k); }
-				inline std::tuple<const node_view, size_t> find_lt_with_index(KR k) const{ return this->template _find_nearest_with_index<_branch_lt>(k); }
-			};
-			
-			using multiset_base = std::conditional_t<with_index::value, multiset_with_index, multiset_base0>;
-		};
-	}
-	
-	template<typename K, typename V, tree_spec S = tree_spec::simple, typename U = std::tuple<>> class map: public avltree_base::avltree<K, V, S, U>::tree_base{
-#ifdef AVLTREE_DEBUG_CLASS
-		friend class AVLTREE_DEBUG_CLASS;
-		using K_ = K;
-		using V_ = V;
-		inline static const avltree::tree_spec S_ = S;
-#endif
-		
-		using base           = typename avltree_base::avltree<K, V, S, U>;
-		using super          = typename base::tree_base;
-		using KR             = typename base::KR;
-		using VR             = typename base::VR;
-		using data_type      = typename base::data_type;
-		using iterator       = typename base::iterator;
-		using node_view      = typename base::node_view;
-		using node_uptr_view = typename base::node_uptr_view;
-		inline static KR get_key(const data_type& data){ return data.first; }
-		inline static VR get_value(const data_type& data){ return data.second; }
-	public:
-		using key_type      = K;
-		using value_type    = V;
-		inline static const avltree::tree_spec tree_spec = S;
-		using with_index    = typename base::with_index;
-		using with_depth    = typename base::with_depth;
-		using with_value    = typename base::with_value;
-		
-		map(): super(){}
-		template<class InputIter> map(InputIter first, InputIter last): super(){
-			for(auto p = first; p != last; p ++){
-				const auto& [k, v] = *p;
-				this->insert(k, v);
-			}
-		}
-		template<typename K_, typename V_> bool insert(K_&& k, V_&& v){
-			return this->_insert(std::forward<K_>(k), std::forward<V_>(v));
-		}
-		
-		using iterator_key   = avltree_base::iterator_wrapper<iterator, const data_type&, KR, get_key>;
-		using iterator_value = avltree_base::iterator_wrapper<iterator, const data_type&, VR, get_value>;
-		
-		inline iterator_key   key_begin()   const { return iterator_key(this->begin()); }
-		inline iterator_value value_begin() const { return iterator_value(this->begin()); }
-		
-		auto reversed() const { return avltree_base::iterator_pair([this](){ return this->rbegin();      }, [this](){ return this->end(); }); }
-		auto keys()     const { return avltree_base::iterator_pair([this](){ return this->key_begin();   }, [this](){ return this->end(); }); }
-		auto values()   const { return avltree_base::iterator_pair([this](){ return this->value_begin(); }, [this](){ return this->end(); }); }
-	
-		template<typename X, X summarize(const X& a, const X& b), X identity(), X get(const typename base::data_type&) = summarizer::pass<data_type>> using with_summary = map<K, V, S, summarizer::tuple_append<U, typename summarizer::single<K, V, S, X, summarize, identity, get>>>;
-		
-// can be used only in C++ 20 or over
-//		template<typename X = int> using with_summary_key_sum    = with_summary<K, summarizer::add, summarizer::zero, summarizer::get_key>;
-//		template<typename X = int> using with_summary_key_prod   = with_summary<K, summarizer::mul, summarizer::one,  summarizer::get_key>;
-//		template<typename X = int> using with_summary_value_sum  = with_summary<V, summarizer::add, summarizer::zero, summarizer::get_value>;
-//		template<typename X = int> using with_summary_value_prod = with_summary<V, summarizer::mul, summarizer::one,  summarizer::get_value>;
-//		template<typename X = int> using with_summary_value_min  = with_summary<V, summarizer::min, summarizer::max_value, summarizer::get_value>;
-//		template<typename X = int> using with_summary_value_max  = with_summary<V, summarizer::max, summarizer::min_value, summarizer::get_value>;
-	};
-
-	template<typename V, tree_spec S = tree_spec::simple, typename U = std::tuple<>> class set: public avltree_base::avltree<V, avltree_base::empty, S, U>::tree_base{
-		using K_ = V;
-		using V_ = avltree_base::empty;
-#ifdef AVLTREE_DEBUG_CLASS
-		friend class AVLTREE_DEBUG_CLASS;
-		inline static const tree_spec S_ = S;
-#endif
-		using base  = typename avltree_base::avltree<V, avltree_base::empty, S, U>;
-		using super = typename base::tree_base;
-	public:
-		using value_type     = V;
-		using with_index     = typename base::with_index;
-		using with_depth     = typename base::with_depth;
-		using with_value     = typename std::false_type;
-		using node_view      = typename base::node_view;
-		using node_uptr_view = typename base::node_uptr_view;
-		set(): super(){}
-		template<class InputIter> set(InputIter first, InputIter last): super(){
-			for(auto p = first; p != last; p ++){
-				this->insert(*p);
-			}
-		}
-		template<typename V_> bool insert(V_&& v){
-			return this->_insert(std::forward<V_>(v));
-		}
-		
-		template<typename X, X summarize(const X& a, const X& b), X identity(), X get(const typename base::data_type&) = summarizer::pass<X>> using with_summary = set<V, S, summarizer::tuple_append<U, typename summarizer::single<K_, V_, S, X, summarize, identity, get>>>;
-	};
-	
-	template<typename V, tree_spec S = tree_spec::simple, typename U = std::tuple<>> class multiset: public avltree_base::avltree<V, avltree_base::empty, S, U>::multiset_base{
-		using K_ = V;
-		using V_ = avltree_base::empty;
-#ifdef AVLTREE_DEBUG_CLASS
-		friend class AVLTREE_DEBUG_CLASS;
-		inline static const tree_spec S_ = S;
-#endif
-		using base  = typename avltree_base::avltree<V, avltree_base::empty, S, U>;
-		using super = typename base::multiset_base;
-	public:
-		using value_type     = V;
-		using with_index     = typename base::with_index;
-		using with_depth     = typename base::with_depth;
-		using with_value     = typename std::false_type;
-		using node_view      = typename base::node_view;
-		using node_uptr_view = typename base::node_uptr_view;
-		multiset(): super(){}
-		template<class InputIter> multiset(InputIter first, InputIter last): super(){
-			for(auto p = first; p != last; p ++){
-				this->insert(*p);
-			}
-		}
-		template<typename X, X summarize(const X& a, const X& b), X identity(), X get(const typename base::data_type&) = summarizer::pass<X>> using with_summary = multiset<V, S, summarizer::tuple_append<U, typename summarizer::single<K_, V_, S, X, summarize, identity, get>>>;
-	};
-	
-	template<typename T> using with_summary_key_sum    = typename T::template with_summary<typename T::key_type,   summarizer::add, summarizer::zero<typename T::key_type>, summarizer::get_key>;
-	template<typename T> using with_summary_key_prod   = typename T::template with_summary<typename T::key_type,   summarizer::mul, summarizer::one<typename T::key_type>,  summarizer::get_key>;
-	template<typename T> using with_summary_value_sum  = typename T::template with_summary<typename T::value_type, summarizer::add, summarizer::zero<typename T::value_type>, summarizer::get_value>;
-	template<typename T> using with_summary_value_prod = typename T::template with_summary<typename T::value_type, summarizer::mul, summarizer::one<typename T::value_type>,  summarizer::get_value>;
-	template<typename T> using with_summary_value_min  = typename T::template with_summary<typename T::value_type, summarizer::min, summarizer::max_value<typename T::value_type>, summarizer::get_value>;
-	template<typename T> using with_summary_value_max  = typename T::template with_summary<typename T::value_type, summarizer::max, summarizer::min_value<typename T::value_type>, summarizer::get_value>;
-	
-	template<typename T> using with_summary_sum  = typename T::template with_summary<typename T::value_type, summarizer::add, summarizer::zero<typename T::value_type>>;
-	template<typename T> using with_summary_prod = typename T::template with_summary<typename T::value_type, summarizer::mul, summarizer::one<typename T::value_type>>;
-
-}
+#include <memory>
+#include <new>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <vector>
+#include <deque>
+#include <array>
+#include <variant>
+#include <optional>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+#include <functional>
+#include <tuple>
+#include <utility>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <stdexcept>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if __cplusplus > 201703L
+#include <compare>
+#endif
+
+namespace avltree{
+	enum class tree_spec: int{
+		simple            = 0,
+		with_index        = 1 << 1,
+		with_depth        = 1 << 2,
+		pass_key_by_ref   = 1 << 3,
+		pass_key_by_val   = 1 << 4,
+		pass_value_by_ref = 1 << 5,
+		pass_value_by_val = 1 << 6,
+		with_multiplicity = 1 << 7,
+		with_key_prefix   = 1 << 8,
+		with_generation   = 1 << 9,
+		with_stats        = 1 << 10,
+		with_latency      = 1 << 11,
+		with_wavl         = 1 << 12,
+		with_extremes     = 1 << 13,
+		with_hash_index   = 1 << 14,
+		with_arena        = 1 << 15,
+		with_tombstone    = 1 << 16,
+		max               = 1 << 17,
+	};
+	
+	inline constexpr tree_spec operator|(const tree_spec v1, const tree_spec v2){ return static_cast<tree_spec>(static_cast<int>(v1) | static_cast<int>(v2)); }
+	inline constexpr bool tree_spec_has(const tree_spec v1, const tree_spec v2){ return (static_cast<int>(v1) & static_cast<int>(v2)) != 0; }
+	
+	namespace avltree_base{
+		class empty{
+			empty() = delete;
+		};
+		template<typename K, typename V, tree_spec S, typename U = std::tuple<>, typename C = std::less<K>> class avltree;
+	}
+	template<typename K, typename V, tree_spec S, typename U, typename C> class map;
+	template<typename V, tree_spec S, typename U, typename C> class multiset;
+	
+	namespace comparator{
+		template<typename T> struct is_tuple_like: std::false_type{};
+		template<typename... T> struct is_tuple_like<std::tuple<T...>>: std::true_type{};
+		template<typename T1, typename T2> struct is_tuple_like<std::pair<T1, T2>>: std::true_type{};
+		
+		// strings compared by contents. pointers to characters are not, as std::less compares them as addresses
+		template<typename T> struct is_string: std::false_type{};
+		template<typename R, typename A> struct is_string<std::basic_string<char, R, A>>: std::true_type{};
+		template<typename R> struct is_string<std::basic_string_view<char, R>>: std::true_type{};
+		template<size_t N> struct is_string<char[N]>: std::true_type{};
+		
+		template<typename A, typename B> inline int three_way(const A& a, const B& b);
+		template<size_t I, typename A, typename B> inline int three_way_tuple(const A& a, const B& b){
+			if constexpr(I == std::tuple_size_v<A>){
+				return 0;
+			}else{
+				const int c = three_way(std::get<I>(a), std::get<I>(b));
+				return c != 0 ? c : three_way_tuple<I + 1>(a, b);
+			}
+		}
+		
+		// three-way comparison in the order of operator<, examining each element only once
+		template<typename A, typename B> inline int three_way(const A& a, const B& b){
+			if constexpr(is_string<std::remove_cv_t<A>>::value && is_string<std::remove_cv_t<B>>::value){
+				const int c = std::string_view(a).compare(std::string_view(b));
+				return (c > 0) - (c < 0);
+			}else if constexpr(is_tuple_like<A>::value && is_tuple_like<B>::value){
+				return three_way_tuple<0>(a, b);
+			}else if constexpr(std::is_arithmetic_v<A> && std::is_arithmetic_v<B>){
+				return (b < a) - (a < b);
+#if __cplusplus > 201703L
+			}else if constexpr(std::three_way_comparable_with<A, B>){
+				const auto c = a <=> b;
+				return (c > 0) - (c < 0);
+#endif
+			}else{
+				return a < b ? -1 : (b < a ? 1 : 0);
+			}
+		}
+		
+		// comparators defining compare(a, b), which returns negative, zero or positive value, are used as three-way comparators
+		template<typename C, typename A, typename B, typename = void> struct has_compare: std::false_type{};
+		template<typename C, typename A, typename B> struct has_compare<C, A, B, std::void_t<decltype(std::declval<const C&>().compare(std::declval<const A&>(), std::declval<const B&>()))>>: std::true_type{};
+		template<typename C> struct is_std_less: std::false_type{};
+		template<typename T> struct is_std_less<std::less<T>>: std::negation<std::is_pointer<T>>{};
+		
+		template<typename C, typename A, typename B> inline int compare(const A& a, const B& b){
+			if constexpr(has_compare<C, A, B>::value){
+				const auto c = C().compare(a, b);
+				return (c > 0) - (c < 0);
+			}else if constexpr(is_std_less<C>::value){
+				return three_way(a, b);
+			}else{
+				return C()(a, b) ? -1 : (C()(b, a) ? 1 : 0);
+			}
+		}
+	}
+	
+	/*
+		order preserving digest of keys under the comparator C, cached in each node with tree_spec::with_key_prefix
+		digest(a) < digest(b) must imply that a is before b by C, and keys are compared only when the digests are equal
+		specialize for other key types or comparators
+	*/
+	template<typename K, typename C = std::less<K>, typename = void> struct key_digest;
+	template<typename K, typename C> struct key_digest<K, C, std::enable_if_t<comparator::is_string<K>::value && comparator::is_std_less<C>::value>>{
+		// first 16 bytes of the string, in big endian
+		using type = std::pair<uint64_t, uint64_t>;
+		template<typename Q> static inline type get(const Q& k){
+			const std::string_view v(k);
+			uint64_t d[2] = {0, 0};
+			for(size_t i = 0; i < 16; i ++){
+				d[i / 8] = (d[i / 8] << 8) | (i < v.size() ? static_cast<unsigned char>(v[i]) : 0);
+			}
+			return type(d[0], d[1]);
+		}
+	};
+	
+	/*
+		codecs for export_stream() and import_stream(). prev is the previous value in the same chunk, or nullptr at the head of a chunk.
+		specialize avltree::stream_codec<T> with encode() and decode() to export other types
+	*/
+	namespace stream_codec_base{
+		inline void put_varint(std::string& out, uint64_t x){
+			while(x >= 0x80){
+				out.push_back((char)(x | 0x80));
+				x >>= 7;
+			}
+			out.push_back((char)x);
+		}
+		inline bool get_varint(const char*& p, const char* e, uint64_t& x){
+			x = 0;
+			for(int shift = 0; p < e && shift < 64; shift += 7){
+				const uint64_t b = static_cast<unsigned char>(*p ++);
+				x |= (b & 0x7f) << shift;
+				if(b < 0x80){
+					return true;
+				}
+			}
+			return false;
+		}
+	}
+	// bytes as is
+	template<typename T, typename = void> struct stream_codec{
+		static_assert(std::is_trivially_copyable_v<T>, "specialize avltree::stream_codec<T> for types not trivially copyable");
+		static inline void encode(std::string& out, const T& x, const T*){ out.append(reinterpret_cast<const char*>(&x), sizeof(T)); }
+		static inline bool decode(const char*& p, const char* e, T& x, const T*){
+			if(e - p < (std::ptrdiff_t)sizeof(T)){
+				return false;
+			}
+			std::memcpy(&x, p, sizeof(T));
+			p += sizeof(T);
+			return true;
+		}
+	};
+	// difference from the previous value, in zigzag varint
+	template<typename T> struct stream_codec<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>{
+		using UT = std::make_unsigned_t<T>;
+		static inline void encode(std::string& out, const T& x, const T* prev){
+			const UT d = (UT)x - (prev ? (UT)*prev : 0);
+			stream_codec_base::put_varint(out, (uint64_t)(UT)((d << 1) ^ (UT)((std::make_signed_t<UT>)d >> (sizeof(UT) * 8 - 1))));
+		}
+		static inline bool decode(const char*& p, const char* e, T& x, const T* prev){
+			uint64_t z;
+			if(!stream_codec_base::get_varint(p, e, z)){
+				return false;
+			}
+			const UT d = (UT)((UT)(z >> 1) ^ (UT)(-(UT)(z & 1)));
+			x = (T)(d + (prev ? (UT)*prev : 0));
+			return true;
+		}
+	};
+	// length of the prefix shared with the previous string, and the rest
+	template<> struct stream_codec<std::string>{
+		static inline void encode(std::string& out, const std::string& x, const std::string* prev){
+			size_t shared = 0;
+			if(prev){
+				const size_t n = std::min(x.size(), prev->size());
+				while(shared < n && x[shared] == (*prev)[shared]){
+					shared ++;
+				}
+			}
+			stream_codec_base::put_varint(out, shared);
+			stream_codec_base::put_varint(out, x.size() - shared);
+			out.append(x, shared, std::string::npos);
+		}
+		static inline bool decode(const char*& p, const char* e, std::string& x, const std::string* prev){
+			uint64_t shared, rest;
+			if(!stream_codec_base::get_varint(p, e, shared) || !stream_codec_base::get_varint(p, e, rest) || shared > (prev ? prev->size() : 0) || rest > (uint64_t)(e - p)){
+				return false;
+			}
+			x.assign(prev ? prev->data() : p, shared);
+			x.append(p, rest);
+			p += rest;
+			return true;
+		}
+	};
+	
+	namespace summarizer{
+		template<typename T> inline T pass(const T& d){ return d; }
+		template<typename D, typename T> inline T get_key(const D& d){ return d.first; }
+		template<typename D, typename T> inline T get_value(const D& d){ return d.second; }
+		
+		template<typename T> inline T add(const T& a, const T& b){ return a + b; }
+		template<typename T> inline T mul(const T& a, const T& b){ return a * b; }
+		template<typename T> inline T max(const T& a, const T& b){ return std::max(a, b); }
+		template<typename T> inline T min(const T& a, const T& b){ return std::min(a, b); }
+		
+		template<typename T> inline std::enable_if_t<std::is_arithmetic_v<T>, T> one(){ return 1; }
+		template<typename T> inline std::enable_if_t<std::is_arithmetic_v<T>, T> zero(){ return 0; }
+		template<typename T> inline std::enable_if_t<std::numeric_limits<T>::is_specialized, T> min_value(){ return std::numeric_limits<T>::min(); }
+		template<typename T> inline std::enable_if_t<std::numeric_limits<T>::is_specialized, T> max_value(){ return std::numeric_limits<T>::max(); }
+
+		// summarizes n copies of x by doubling, for nodes holding multiple copies of a value
+		template<typename Z> inline typename Z::type repeat(typename Z::type x, size_t n){
+			typename Z::type result(Z::identity_());
+			while(n > 0){
+				if(n & 1){
+					Z::accumulate_(result, x);
+				}
+				n >>= 1;
+				if(n > 0){
+					Z::accumulate_(x, x);
+				}
+			}
+			return result;
+		}
+		
+		template<typename U, typename T> using tuple_append = decltype(std::tuple_cat(std::declval<U>(), std::make_tuple(std::declval<T>())));
+		template<typename U, size_t I> struct summarizer_tuple_converter{
+			using tuple_type = tuple_append<typename summarizer_tuple_converter<U, I - 1>::tuple_type, typename std::tuple_element_t<I - 1, U>::type>;
+		};
+		template<typename U> struct summarizer_tuple_converter<U, 0>{
+			using tuple_type = std::tuple<>;
+		};
+		
+		template<typename K, typename V, tree_spec S, typename T, T summarize(const T& a, const T& b), T identity(), T get(const typename avltree_base::avltree<K, V, S>::data_type&) = pass<T>> struct single{
+			using data_type = typename avltree_base::avltree<K, V, S>::data_type;
+			using type = T;
+			inline static T get_(const data_type& d)          { return get(d); }
+			inline static T summarize_(const T& a, const T& b){ return summarize(a, b); }
+			inline static T identity_()                       { return identity(); }
+			inline static void accumulate_(T& a, const T& b)  { a = summarize(a, b); }
+			inline static T repeat_(const T& a, size_t n)     { return n == 1 ? a : repeat<single>(a, n); }
+		};
+		
+		template<typename K, typename V, tree_spec S, typename U> struct combined{
+			using data_type = typename avltree_base::avltree<K, V, S>::data_type;
+			using type = typename summarizer_tuple_converter<U, std::tuple_size_v<U>>::tuple_type;
+		private:
+			template<size_t I> static inline auto get__(const data_type& d){
+				const auto t = std::make_tuple(std::tuple_element_t<I, U>::get_(d));
+				if constexpr(I + 1 < std::tuple_size_v<U>){
+					return std::tuple_cat(t, get__<I + 1>(d));
+				}else{
+					return t;
+				}
+			}
+			template<size_t I> static inline auto summarize__(const type& a, const type& b){
+				const auto t = std::make_tuple(std::tuple_element_t<I, U>::summarize_(std::get<I>(a), std::get<I>(b)));
+				if constexpr(I + 1 < std::tuple_size_v<U>){
+					return std::tuple_cat(t, summarize__<I + 1>(a, b));
+				}else{
+					return t;
+				}
+			}
+			template<size_t I> static inline auto identity__(){
+				const auto t = std::make_tuple(std::tuple_element_t<I, U>::identity_());
+				if constexpr(I + 1 < std::tuple_size_v<U>){
+					return std::tuple_cat(t, identity__<I + 1>());
+				}else{
+					return t;
+				}
+			}
+		public:
+			static inline type get_(const data_type& d){ return get__<0>(d); }
+			static inline type summerize_(const type& a, const type& b){ return summarize__<0>(a, b); }
+			static inline type identity_(){ return identity__<0>(); }
+			static inline void accumulate_(type& a, const type& b){ a = summarize__<0>(a, b); }
+			static inline type repeat_(const type& a, size_t n){ return n == 1 ? a : repeat<combined>(a, n); }
+		};
+
+		template<typename K, typename V, tree_spec S, typename U> using tuple_to_summarizer = 
+			std::conditional_t<std::tuple_size_v<U> == 0, avltree_base::empty, 
+			std::conditional_t<std::tuple_size_v<U> == 1, std::tuple_element_t<0, tuple_append<U, int>>, // to avoid error caused by std::tuple_element<0, tuple<>>
+					combined<K, V, S, U>>>;
+	}
+	
+	// bytes held by a tree. buffers allocated by the elements themselves, such as those of std::string, are not included
+	struct memory_usage_report{
+		size_t nodes;
+		size_t node_bytes;     // sizeof the node for each node, which includes all below but the scratch
+		size_t payload_bytes;  // keys and values
+		size_t summary_bytes;  // cached summaries
+		size_t link_bytes;     // links, balance or depth, counts and the other bookkeeping
+		size_t scratch_bytes;  // path stack reserved by the tree for updates
+		size_t total_bytes;
+	};
+	
+	// latencies in nanoseconds, where count[i] is the number of the operations taking [2^i, 2^(i + 1)) ns (count[0] also includes 0 ns)
+	struct latency_histogram{
+		static const size_t buckets = 40;
+		uint64_t count[buckets];
+		uint64_t sum_ns;
+		inline void record(uint64_t ns){
+			size_t i = 0;
+			while(i + 1 < buckets && (ns >> (i + 1)) > 0){
+				i ++;
+			}
+			count[i] ++;
+			sum_ns += ns;
+		}
+		inline uint64_t total() const{
+			uint64_t n = 0;
+			for(const auto c: count){
+				n += c;
+			}
+			return n;
+		}
+	};
+	
+	// operation counters of a tree with tree_spec::with_stats. the histograms are recorded only with tree_spec::with_latency.
+	// the counters are plain integers updated also by const member functions such as find(), so readers on several threads race on them
+	struct operation_stats{
+		uint64_t comparisons;       // key comparisons in searches and summaries
+		uint64_t nodes_visited;     // nodes visited in searches
+		uint64_t single_rotations;
+		uint64_t double_rotations;
+		uint64_t rebalance_steps;   // ancestors examined to fix the balance after insertions and removals
+		uint64_t allocations;       // nodes allocated by insertions
+		uint64_t releases;          // nodes unlinked by removals
+		latency_histogram insert, remove, find, summarize;
+		
+		// writes the counters and the histograms in the Prometheus text format
+		void write_prometheus(std::ostream& os, const std::string& name = "avltree") const{
+			const std::pair<const char*, uint64_t> counters[] = {
+				{"comparisons", comparisons}, {"nodes_visited", nodes_visited}, {"single_rotations", single_rotations}, {"double_rotations", double_rotations},
+				{"rebalance_steps", rebalance_steps}, {"allocations", allocations}, {"releases", releases},
+			};
+			for(const auto& [counter, value]: counters){
+				os << "# TYPE " << name << "_" << counter << "_total counter\n";
+				os << name << "_" << counter << "_total " << value << "\n";
+			}
+			const std::pair<const char*, const latency_histogram*> histograms[] = {{"insert", &insert}, {"remove", &remove}, {"find", &find}, {"summarize", &summarize}};
+			for(const auto& [op, h]: histograms){
+				const std::string metric = name + "_" + op + "_latency_seconds";
+				os << "# TYPE " << metric << " histogram\n";
+				size_t last = 0;
+				for(size_t i = 0; i < latency_histogram::buckets; i ++){
+					if(h->count[i] > 0){
+						last = i;
+					}
+				}
+				uint64_t cumulative = 0;
+				for(size_t i = 0; i <= last; i ++){
+					cumulative += h->count[i];
+					os << metric << "_bucket{le=\"" << (double)((uint64_t)1 << (i + 1)) * 1e-9 << "\"} " << cumulative << "\n";
+				}
+				os << metric << "_bucket{le=\"+Inf\"} " << h->total() << "\n";
+				os << metric << "_sum " << (double)h->sum_ns * 1e-9 << "\n";
+				os << metric << "_count " << h->total() << "\n";
+			}
+		}
+	};
+	
+	struct tree_stats{
+		size_t nodes;
+		size_t height;
+		std::vector<size_t> depth_histogram;   // number of the nodes at each depth, where the root is at 0
+		double average_path_length;            // average number of the nodes visited to find each node
+		size_t balance_histogram[3];           // number of the nodes whose balance is -1, 0 and 1. with tree_spec::with_wavl, the rank differences of the children
+		size_t optimal_height;                 // height of a perfectly balanced tree of the same number of nodes
+		double optimal_average_path_length;
+	};
+	
+	namespace avltree_base{
+		template<typename I, typename O, typename T, T F(O)> class iterator_wrapper{
+			I i;
+		public:
+			inline iterator_wrapper(I&& i_): i(std::move(i_)){}
+			template<typename E> inline bool operator==(const E& e) const { return i == e; };
+			template<typename E> inline bool operator!=(const E& e) const { return i != e; };
+			template<typename E> friend inline bool operator==(const E& e, const iterator_wrapper& i) { return e == i.i; };
+			template<typename E> friend inline bool operator!=(const E& e, const iterator_wrapper& i) { return e != i.i; };
+			inline T operator*() const { return F(*i); };
+			inline iterator_wrapper& operator++(){ ++ i; return *this; }
+			inline iterator_wrapper& operator--(){ -- i; return *this; }
+			inline iterator_wrapper operator++(int){ auto _i = *this; i.i ++; return _i; }
+			inline iterator_wrapper operator--(int){ auto _i = *this; i.i --; return _i; }
+		};
+		
+		template<typename B, typename E> class iterator_pair{
+			const B b;
+			const E e;
+		public:
+			inline iterator_pair(B&& b_, E&& e_): b(std::move(b_)), e(std::move(e_)){}
+			inline auto begin(){ return b(); }
+			inline auto end(){ return e(); }
+		};
+		
+		template <size_t N = 0, typename... T> static std::string to_string(const std::tuple<T...>& v){
+			std::string result = "";
+			if constexpr(N == 0){
+				result += "(";
+			}
+			result += to_string(std::get<N>(v));
+			if constexpr(N == sizeof...(T) - 1){
+				result += ")";
+			}else{
+				result += "," + to_string<N + 1, T...>(v);
+			}
+			return result;
+		}
+		
+		template <typename T> static std::string to_string(const T& v){
+			return std::to_string(v);
+		}
+		
+
+		template<typename T, typename = void> struct is_transparent: std::false_type{};
+		template<typename T> struct is_transparent<T, std::void_t<typename T::is_transparent>>: std::true_type{};
+		template<typename T, typename = void> struct is_complete: std::false_type{};
+		template<typename T> struct is_complete<T, std::void_t<decltype(sizeof(T))>>: std::true_type{};
+		
+		// blocks of a fixed size carved out of chunks, which double in size up to max_chunk_blocks.
+		// released blocks are chained in a free list and reused, and all blocks are freed at once with the chunks
+		class node_arena{
+			struct alignas(std::max_align_t) unit{ unsigned char bytes[alignof(std::max_align_t)]; };
+			inline static const size_t first_chunk_blocks = 64;
+			inline static const size_t max_chunk_blocks = 1 << 16;
+			std::vector<std::unique_ptr<unit[]>> chunks;
+			std::vector<std::pair<const void*, const void*>> ranges; // the chunks sorted by address
+			size_t block_units; // size of a block in units of the alignment of max_align_t
+			size_t chunk_blocks;
+			size_t next;        // blocks handed out from the last chunk
+			size_t used;
+			size_t reserved;
+			void* free_list;
+			bool seq;
+		public:
+			inline node_arena(size_t bytes): chunks(), ranges(), block_units((std::max(bytes, sizeof(void*)) + sizeof(unit) - 1) / sizeof(unit)), chunk_blocks(0), next(0), used(0), reserved(0), free_list(nullptr), seq(false){}
+			node_arena(const node_arena&) = delete;
+			node_arena& operator=(const node_arena&) = delete;
+			inline void* allocate(){
+				used ++;
+				if(free_list && !seq){
+					void* p = free_list;
+					free_list = *static_cast<void**>(p);
+					return p;
+				}
+				if(next == chunk_blocks){
+					chunk_blocks = chunks.empty() ? first_chunk_blocks : std::min(chunk_blocks * 2, max_chunk_blocks);
+					chunks.emplace_back(new unit[chunk_blocks * block_units]);
+					const std::pair<const void*, const void*> range(chunks.back().get(), chunks.back().get() + chunk_blocks * block_units);
+					ranges.insert(std::upper_bound(ranges.begin(), ranges.end(), range), range);
+					reserved += chunk_blocks;
+					next = 0;
+				}
+				return chunks.back().get() + block_units * next ++;
+			}
+			inline void deallocate(void* p){
+				used --;
+				::new(p) void*(free_list);
+				free_list = p;
+			}
+			// whether p is a block of this arena
+			inline bool owns(const void* p) const{
+				auto it = std::upper_bound(ranges.begin(), ranges.end(), p, [](const void* p, const std::pair<const void*, const void*>& r){ return std::less<const void*>()(p, r.first); });
+				return it != ranges.begin() && std::less<const void*>()(p, (-- it)->second);
+			}
+			// while set, blocks are handed out from the chunks only, so that consecutive allocations are adjacent
+			inline bool sequential(bool s){ return std::exchange(seq, s); }
+			// blocks in use
+			inline size_t size() const{ return used; }
+			inline size_t reserved_bytes() const{ return reserved * block_units * sizeof(unit); }
+		};
+		
+		template<typename K, typename V, tree_spec S, typename U, typename C> class avltree{
+			friend class ::avltree::multiset<K, S, U, C>;
+#ifdef AVLTREE_DEBUG_CLASS
+				friend class AVLTREE_DEBUG_CLASS;
+#endif
+			static_assert(!tree_spec_has(S, tree_spec::max), "invalid tree_spec");
+			static_assert(!(tree_spec_has(S, tree_spec::pass_key_by_ref) && tree_spec_has(S, tree_spec::pass_key_by_val)), "invalid tree_spec: both flags passing key by reference and value cannot be specified at same time");
+			static_assert(!(tree_spec_has(S, tree_spec::pass_value_by_ref) && tree_spec_has(S, tree_spec::pass_value_by_val)), "invalid tree_spec: both flags passing value by reference and value cannot be specified at same time");
+			avltree() = delete;
+		public:
+			using with_depth    = std::conditional_t<tree_spec_has(S, tree_spec::with_depth), std::true_type, std::false_type>;
+			using with_index    = std::conditional_t<tree_spec_has(S, tree_spec::with_index), std::true_type, std::false_type>;
+			using with_summary  = std::negation<std::is_same<U, std::tuple<>>>;
+			using with_value    = std::negation<std::is_same<V, empty>>;
+			using with_multiplicity = std::conditional_t<tree_spec_has(S, tree_spec::with_multiplicity), std::true_type, std::false_type>;
+			using with_key_prefix   = std::conditional_t<tree_spec_has(S, tree_spec::with_key_prefix), std::true_type, std::false_type>;
+			using with_generation   = std::conditional_t<tree_spec_has(S, tree_spec::with_generation), std::true_type, std::false_type>;
+			using with_latency      = std::conditional_t<tree_spec_has(S, tree_spec::with_latency), std::true_type, std::false_type>;
+			using with_stats        = std::conditional_t<tree_spec_has(S, tree_spec::with_stats) || with_latency::value, std::true_type, std::false_type>;
+			using with_wavl         = std::conditional_t<tree_spec_has(S, tree_spec::with_wavl), std::true_type, std::false_type>;
+			using with_extremes     = std::conditional_t<tree_spec_has(S, tree_spec::with_extremes), std::true_type, std::false_type>;
+			using with_hash_index   = std::conditional_t<tree_spec_has(S, tree_spec::with_hash_index), std::true_type, std::false_type>;
+			using with_arena        = std::conditional_t<tree_spec_has(S, tree_spec::with_arena), std::true_type, std::false_type>;
+			using with_tombstone    = std::conditional_t<tree_spec_has(S, tree_spec::with_tombstone), std::true_type, std::false_type>;
+			static_assert(!with_tombstone::value || with_index::value, "invalid tree_spec: with_tombstone requires with_index");
+			static_assert(!with_tombstone::value || !(with_multiplicity::value || with_generation::value || with_extremes::value || with_hash_index::value), "invalid tree_spec: with_tombstone is not available with with_multiplicity, with_generation, with_extremes or with_hash_index");
+			
+			using use_ref_k = std::bool_constant<(tree_spec_has(S, tree_spec::pass_key_by_ref) || (!tree_spec_has(S, tree_spec::pass_key_by_val) && sizeof(std::tuple<K>) > sizeof(std::nullptr_t)))>;
+			using use_ref_v = std::bool_constant<(tree_spec_has(S, tree_spec::pass_value_by_ref) || (!tree_spec_has(S, tree_spec::pass_value_by_val) && sizeof(std::tuple<V>) > sizeof(std::nullptr_t)))>;
+			
+			using KR = std::conditional_t<use_ref_k::value, const K&, const K>;
+			using VR = std::conditional_t<use_ref_v::value, const V&, const V>;
+			
+			using key_compare = C;
+			using is_transparent = avltree_base::is_transparent<C>;
+			// type of the keys passed to lookups: other types than K are passed as is only when C is transparent
+			template<typename Q> using QR = std::conditional_t<is_transparent::value && !std::is_same_v<Q, K>, const Q&, KR>;
+			
+			struct no_digest{};
+			template<bool P, typename = void> struct digest_of{ using type = no_digest; };
+			static_assert(!with_key_prefix::value || is_complete<key_digest<K, C>>::value, "invalid tree_spec: with_key_prefix requires avltree::key_digest<K, C>, which is given only for string keys with std::less");
+			template<typename D> struct digest_of<true, D>{ using type = typename key_digest<K, C>::type; };
+			using digest_type = typename digest_of<with_key_prefix::value>::type;
+			template<typename Q> inline static digest_type _digest(const Q& k){
+				if constexpr(with_key_prefix::value){
+					return key_digest<K, C>::get(k);
+				}else{
+					return no_digest();
+				}
+			}
+			
+			using data_type = std::conditional_t<with_value::value, std::pair<K, V>, K>;
+
+		private:
+			class node_with_value;
+			class node_without_value;
+			using node = std::conditional_t<with_value::value, node_with_value, node_without_value>;
+			using node_uptr = std::unique_ptr<node>;
+		private:
+			static std::string node_to_string(const node& node){
+				std::string ret = "(" + avltree_base::to_string(node.key());
+				
+				if constexpr(with_multiplicity::value){
+					ret += ", m=" + avltree_base::to_string(node.m);
+				}
+				if constexpr(with_tombstone::value){
+					if(node.dead){
+						ret += ", dead";
+					}
+				}
+				if constexpr(with_index::value){
+					ret += ", c=" + avltree_base::to_string(node.c);
+				}
+				if constexpr(with_depth::value){
+					ret += ", h=" + avltree_base::to_string(node.h);
+				}else{
+					ret += ", b=" + avltree_base::to_string(node.balance());
+				}
+				if constexpr(with_wavl::value){
+					ret += ", r=" + avltree_base::to_string(node.rank);
+				}
+				
+				ret += ")";
+				if constexpr(with_value::value){
+					ret += "-> " + avltree_base::to_string(node.value());
+				}
+				
+				return ret;
+			}
+			static void print_node(const node& node, bool top, std::string indent, bool lr_flag){
+				if(node.l){
+					print_node(*node.l, false, top ? "" : indent + (lr_flag ? "   " : "  |"), true);
+				}
+				
+				if(top){
+					std::cout << "-" << node_to_string(node) << std::endl;
+					if(node.r){
+						std::cout << "  |" << std::endl;
+					}
+				}else{
+					std::cout << indent << "  +" << node_to_string(node) << std::endl;
+					
+					if(lr_flag || node.r || indent.find("|") != std::string::npos){
+						std::cout << indent;
+						if(lr_flag && node.r){
+							std::cout << "  |  |" << std::endl;
+						}else if(lr_flag){
+							std::cout << "  |" << std::endl;
+						}else if(node.r){
+							std::cout << "     |" << std::endl;
+						}else{
+							std::cout << std::endl;
+						}
+					}
+				}
+				if(node.r){
+					print_node(*node.r, false, top ? "" : indent + (lr_flag ? "  |" : "   "), false);
+				}
+			}
+			
+			/*
+				NODE BASE : node_base0
+			*/
+			
+			struct node_base0{
+				std::unique_ptr<node> l, r;
+				inline size_t weight() const { return 1; }
+			protected:
+				inline node_base0() : l(), r() {}
+				// copies the contents of the node only. the children are copied by tree_base0::_clone()
+				inline node_base0(const node_base0&) : l(), r() {}
+			};
+			
+			/*
+				WITH BALANCE or DEPTH : node_base1
+			*/
+			
+			struct node_with_balance: public node_base0{
+				int b;
+				inline int balance() const { return b; }
+			protected:
+				inline node_with_balance(): node_base0(), b(0) {}
+			};
+			
+			struct node_with_depth: public node_base0{
+				int h;
+				inline int depth_l() const { return this->l ? this->l->h : 0; }
+				inline int depth_r() const { return this->r ? this->r->h : 0; }
+				inline void reset_depth(){
+					h = std::max(depth_l(), depth_r()) + 1;
+				}
+				inline int balance() const { return depth_l() - depth_r(); }
+			protected:
+				inline node_with_depth(): node_base0(), h(1) {}
+			};
+			
+			/*
+				rank of weak AVL trees: the rank differences of each node to its children are 1 or 2, missing children have rank -1, and leaves have rank 0.
+				the rank is an upper bound of the height, and is at most 2 log N
+			*/
+			struct node_with_rank: public node_base0{
+				int rank;
+				inline int rank_l() const { return this->l ? this->l->rank : -1; }
+				inline int rank_r() const { return this->r ? this->r->rank : -1; }
+				inline int balance() const { return rank_l() - rank_r(); }
+			protected:
+				inline node_with_rank(): node_base0(), rank(0) {}
+			};
+			
+			struct node_with_depth_and_rank: public node_with_depth{
+				int rank;
+			protected:
+				inline node_with_depth_and_rank(): node_with_depth(), rank(0) {}
+			};
+			
+			using node_base1 = std::conditional_t<with_depth::value, std::conditional_t<with_wavl::value, node_with_depth_and_rank, node_with_depth>, std::conditional_t<with_wavl::value, node_with_rank, node_with_balance>>;
+			
+			/*
+				WITH MULTIPLICITY or TOMBSTONE or not : node_base2
+			*/
+			
+			struct node_with_multiplicity : public node_base1{
+				size_t m;
+				inline size_t weight() const { return m; }
+			protected:
+				inline node_with_multiplicity() : node_base1(), m(1) {}
+			};
+			
+			// a removed node stays in the tree with weight 0 until the tree is compacted
+			struct node_with_tombstone : public node_base1{
+				bool dead;
+				inline size_t weight() const { return dead ? 0 : 1; }
+			protected:
+				inline node_with_tombstone() : node_base1(), dead(false) {}
+			};
+			
+			using node_base2 = std::conditional_t<with_multiplicity::value, node_with_multiplicity, std::conditional_t<with_tombstone::value, node_with_tombstone, node_base1>>;
+			
+			/*
+				WITH COUNT(INDEX) or not : node_base3
+			*/
+			
+			struct node_with_count : public node_base2{
+				size_t c;
+			protected:
+				inline node_with_count() : node_base2(), c(1) {}
+			public:
+				inline void update_count(){
+					const auto cl = this->l ? this->l->c : 0;
+					const auto cr = this->r ? this->r->c : 0;
+					c = cl + cr + this->weight();
+				}
+			};
+			
+			using node_base3 = std::conditional_t<with_index::value, node_with_count, node_base2>;
+			
+			/*
+				WITH VALUE or not : node_base4
+			*/
+			
+			struct node_base_with_value : public node_base3{
+				data_type data;
+				inline KR key() const { return data.first; }
+				inline K& key(){ return data.first; }
+				inline VR value() const{ return data.second; }
+				inline V& value(){ return data.second; }
+				template<typename... A> inline node_base_with_value(A&&... a): data(std::forward<A>(a)...){}
+			};
+			struct node_base_without_value : public node_base3{
+				data_type data;
+				inline KR key() const { return data; }
+				inline K& key(){ return data; }
+				template<typename... A> inline node_base_without_value(A&&... a): data(std::forward<A>(a)...){}
+			};
+			
+			using node_base4 = std::conditional_t<with_value::value, node_base_with_value, node_base_without_value>;
+			
+			/*
+				WITH KEY PREFIX or not : node_base5
+			*/
+			
+			struct node_with_prefix : public node_base4{
+				digest_type p;
+				template<typename... A> inline node_with_prefix(A&&... a): node_base4(std::forward<A>(a)...), p(_digest(this->key())){}
+			};
+			
+			using node_base5 = std::conditional_t<with_key_prefix::value, node_with_prefix, node_base4>;
+			
+			/*
+				WITH SUMMARY or not : node_base6
+			*/
+			
+			using summarizer = summarizer::tuple_to_summarizer<K, V, S, U>;
+			
+			struct node_with_summary : public node_base5{
+				typename summarizer::type s;
+			protected:
+				template<typename... A> node_with_summary(A&&... a): node_base5(std::forward<A>(a)...), s(summarizer::identity_())/*, k_min(nullptr), k_max(nullptr)*/{ update_summary(); }
+			public:
+				// summary of n copies of the data of this node
+				inline typename summarizer::type own_summary(size_t n) const{
+					if constexpr(with_multiplicity::value){
+						return summarizer::repeat_(summarizer::get_(this->data), n);
+					}else if constexpr(with_tombstone::value){
+						return n ? summarizer::get_(this->data) : summarizer::identity_();
+					}else{
+						return summarizer::get_(this->data);
+					}
+				}
+				inline typename summarizer::type own_summary() const{ return own_summary(this->weight()); }
+				inline void update_summary(){
+					s = own_summary();
+					if(this->l){
+						summarizer::accumulate_(s, this->l->s);
+					}
+					if(this->r){
+						summarizer::accumulate_(s, this->r->s);
+					}
+				}
+			};
+			
+			using node_base6 = std::conditional_t<with_summary::value, node_with_summary, node_base5>;
+			
+			/*
+				WITH GENERATION or not : node_base7
+			*/
+			
+			struct node_with_generation : public node_base6{
+				uint64_t g; // generation in which the node or its descendants were last modified
+				template<typename... A> inline node_with_generation(A&&... a): node_base6(std::forward<A>(a)...), g(0){}
+			};
+			
+			using node_base7 = std::conditional_t<with_generation::value, node_with_generation, node_base6>;
+			
+			/*
+				WITH ARENA or not : node_base8
+			*/
+			
+			struct node_with_arena : public node_base7{
+				// set by avltree::forest during its operations. the nodes are allocated by the global operator new while it is null
+				inline static thread_local node_arena* arena = nullptr;
+				// from_arena of the node being deleted, passed from the destructor to operator delete
+				inline static thread_local bool deleting_from_arena = false;
+				bool from_arena;
+				template<typename... A> inline node_with_arena(A&&... a): node_base7(std::forward<A>(a)...), from_arena(arena != nullptr){}
+				inline node_with_arena(const node_with_arena& n): node_base7(static_cast<const node_base7&>(n)), from_arena(arena != nullptr){}
+				// the children are deleted first, so that operator delete of this node receives its own from_arena
+				inline ~node_with_arena(){
+					this->l.reset();
+					this->r.reset();
+					deleting_from_arena = from_arena;
+				}
+				inline static void* operator new(size_t n){ return arena ? arena->allocate() : ::operator new(n); }
+				// a node goes back to where it came from. a node of an arena which is not the current one, as after it escaped the operation of the forest, is left to the arena, which frees it with the chunks
+				inline static void operator delete(void* p){
+					if(!deleting_from_arena){
+						::operator delete(p);
+					}else if(arena && arena->owns(p)){
+						arena->deallocate(p);
+					}
+				}
+			};
+			
+			using node_base8 = std::conditional_t<with_arena::value, node_with_arena, node_base7>;
+			
+			/*
+				WITH VALUE or not
+			*/
+			
+			struct node_with_value: node_base8{
+				// the arguments are passed to the constructor of data_type, so std::piecewise_construct is also available
+				template<typename... A> inline node_with_value(A&&... a): node_base8(std::forward<A>(a)...){}
+				inline void print() const{ print_node(*this, true, "", true); }
+			};
+			
+			struct node_without_value: node_base8{
+				template<typename... A> inline node_without_value(A&&... a): node_base8(std::forward<A>(a)...){}
+				inline void print() const{ print_node(*this, true, "", true); }
+			};
+			
+			template<typename N> struct node_view_base0{
+			protected:
+				N n;
+				inline node_view_base0(const N& _n): n(_n){}
+				inline node_view_base0(N&& _n): n(std::move(_n)){}
+			public:
+				inline operator bool() const { return n != nullptr; }
+				inline bool operator==(std::nullptr_t n) const { return !*this; }
+				inline const data_type& operator*() const& { return n->data; }
+				inline const data_type operator*() && { return std::move(n->data); }
+				inline data_type const* operator->() const& { return &n->data; }
+				inline size_t multiplicity() const { return n->weight(); }
+			};
+			
+			template<typename N> struct node_view_with_count: public node_view_base0<N>{
+			protected:
+				inline node_view_with_count(const N& n_): node_view_base0<N>(n_){}
+				inline node_view_with_count(N&& n_): node_view_base0<N>(std::move(n_)){}
+			public:
+				inline size_t size() const { return this->n->c; }
+			};
+			
+			template<typename N> using node_view_base1 = std::conditional_t<with_index::value, node_view_with_count<N>, node_view_base0<N>>;
+			
+			template<typename N> struct node_view_with_depth: public node_view_base1<N>{
+			protected:
+				inline node_view_with_depth(const N& n_): node_view_base1<N>(n_){}
+				inline node_view_with_depth(N&& n_): node_view_base1<N>(std::move(n_)){}
+			public:
+				inline size_t height() const { return this->n->h; }
+			};
+			
+			template<typename N> using node_view_base2 = std::conditional_t<with_depth::value, node_view_with_depth<N>, node_view_base1<N>>;
+			
+		public:
+			class node_view: public node_view_base2<const node*>{
+			public:
+				inline explicit node_view(const node* n_): node_view_base2<const node*>(n_){}
+				inline explicit node_view(const node_uptr& n_): node_view_base2<const node*>(n_.get()){};
+				inline friend bool operator==(std::nullptr_t p, const node_view& n) { return !n; }
+			};
+			
+			class node_uptr_view: public node_view_base2<node_uptr>{
+				friend class avltree;
+			public:
+				inline explicit node_uptr_view(node_uptr&& n_): node_view_base2<node_uptr>(std::move(n_)){}
+				inline friend bool operator==(std::nullptr_t p, const node_uptr_view& n) { return !n; }
+				// the key and the value can be modified before inserting the node again
+				inline K& key(){ return this->n->key(); }
+				inline V& value(){ return this->n->value(); }
+			};
+			
+			// nodes detached at once by erase_range() or erase_index_range(), which are destroyed with this object
+			class erased_range{
+				node_uptr root;
+				size_t n;
+				template<typename F> inline static void _for_each(const node* cur, F& f){
+					if(cur){
+						_for_each(cur->l.get(), f);
+						for(size_t i = 0; i < cur->weight(); i ++){
+							f(cur->data);
+						}
+						_for_each(cur->r.get(), f);
+					}
+				}
+			public:
+				inline erased_range(node_uptr&& root_, size_t n_): root(std::move(root_)), n(n_){}
+				// number of the erased elements
+				inline size_t size() const{ return n; }
+				// calls f for each erased data in order
+				template<typename F> inline void for_each(F&& f) const{ _for_each(root.get(), f); }
+			};
+			
+		private:
+			inline static node_uptr _release(node_uptr_view&& n){ return std::move(n.n); }
+			
+		private:
+			using branch_func = std::function<int(const node&)>;
+			
+			// -1, 0 or 1, comparing keys only once
+			template<typename A, typename B> inline static int _compare(const A& a, const B& b){ return comparator::compare<C>(a, b); }
+			
+			// searched key and its digest, which is calculated once per search
+			template<typename KA> struct query{
+				KA k;
+				digest_type d;
+				inline query(KA k_): k(k_), d(_digest(k_)){}
+			};
+			// comparisons in the current thread, which each tree adds to its counters per operation
+			inline static thread_local uint64_t _comparisons = 0;
+			template<typename KA> inline static int _compare(const query<KA>& q, const node& cur){
+				if constexpr(with_stats::value){
+					_comparisons ++;
+				}
+				if constexpr(with_key_prefix::value){
+					const int c = comparator::three_way(q.d, cur.p);
+					if(c != 0){
+						return c;
+					}
+				}
+				return _compare(q.k, cur.key());
+			}
+			
+			// whether the node is removed but left in the tree, which only happens with tree_spec::with_tombstone
+			inline static bool _is_dead(const node& n){
+				if constexpr(with_tombstone::value){
+					return n.dead;
+				}else{
+					return false;
+				}
+			}
+			
+			template<bool L2R = true> class iterator_base: public node_view{
+				std::vector<const node*> _stack;
+				int _depth;
+				size_t _rep; // position among the copies held by the current node (with_multiplicity only)
+				const node* cur() const { return this->n; }
+				const node* &cur(){ return this->n; }
+				template<bool F> inline void _down_to_leaf(){
+					while(true){
+						const auto& c = (L2R ^ !F) ? cur()->l : cur()->r;
+						if(!c){
+							break;
+						}
+						_stack[_depth] = cur();
+						_depth ++;
+						cur() = c.get();
+					}
+				}
+				template<bool F> inline void _forward(){
+					const auto& c = (L2R ^ !F) ? cur()->r : cur()->l;
+					if(c){
+						_stack[_depth] = cur();
+						_depth ++;
+						cur() = c.get();
+						_down_to_leaf<F>();
+					}else{
+						while(true){
+							if(_depth > 0){
+								auto child = cur();
+								_depth --;
+								cur() = _stack[_depth];
+								if(((L2R ^ !F) ? cur()->l.get() : cur()->r.get()) == child){
+									break;
+								}
+							}else{
+								cur() = nullptr;
+								break;
+							}
+						}
+					}
+				}
+				// steps over the dead nodes
+				template<bool F> inline void _skip(){
+					while(cur() && _is_dead(*cur())){
+						_forward<F>();
+					}
+				}
+				inline void _next(){
+					if constexpr(with_multiplicity::value){
+						if(_rep + 1 < cur()->m){
+							_rep ++;
+							return;
+						}
+						_rep = 0;
+					}
+					_forward<true>();
+					_skip<true>();
+				}
+				inline void _prev(){
+					if constexpr(with_multiplicity::value){
+						if(_rep > 0){
+							_rep --;
+							return;
+						}
+					}
+					_forward<false>();
+					_skip<false>();
+					if constexpr(with_multiplicity::value){
+						_rep = cur() ? cur()->m - 1 : 0;
+					}
+				}
+			public:
+				inline iterator_base(size_t stack_size, const node* root, const bool D = true) : node_view(root), _stack(stack_size), _depth(0), _rep(0){
+					if(cur()){
+						if(D){
+							_down_to_leaf<true>();
+							_skip<true>();
+						}else{
+							_down_to_leaf<false>();
+							_skip<false>();
+							if constexpr(with_multiplicity::value){
+								_rep = cur()->m - 1;
+							}
+						}
+					}
+				}
+				inline iterator_base(size_t stack_size, const node* root, branch_func branch, const size_t& rep = 0) : node_view(root), _stack(stack_size), _depth(0), _rep(0){
+					while(cur()){
+						const int b = branch(*cur());
+						if(b == 0){
+							break;
+						}
+						_stack[_depth] = cur();
+						_depth ++;
+						if(b == -1){
+							cur() = cur()->l.get();
+						}else{
+							cur() = cur()->r.get();
+						}
+					}
+					if(cur() && _is_dead(*cur())){
+						cur() = nullptr;
+					}
+					if(!cur()){
+						_depth = 0;
+					}else if constexpr(with_multiplicity::value){
+						_rep = L2R ? rep : cur()->m - 1 - rep;
+					}
+				}
+				inline bool operator==(std::nullptr_t _) const{ return cur() == nullptr; }
+				inline bool operator!=(std::nullptr_t _) const{ return cur() != nullptr; }
+				inline iterator_base& operator++(){ _next(); return *this;}
+				inline iterator_base& operator--(){ _prev(); return *this; }
+				inline iterator_base operator++(int){ auto i = *this; ++*this; return i; }
+				inline iterator_base operator--(int){ auto i = *this; --*this; return i; }
+			};
+			
+			class latency_scope{
+				latency_histogram& h;
+				const std::chrono::steady_clock::time_point start;
+			public:
+				inline latency_scope(latency_histogram& h_): h(h_), start(std::chrono::steady_clock::now()){}
+				inline ~latency_scope(){ h.record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()); }
+				latency_scope(const latency_scope&) = delete;
+			};
+			struct no_scope{};
+			
+			class stats_holder{
+			protected:
+				mutable operation_stats _stats; // not synchronized. a tree with with_stats is not safe for concurrent const calls
+				stats_holder(): _stats(){}
+			public:
+				inline const operation_stats& counters() const{ return _stats; }
+				inline void reset_counters(){ _stats = operation_stats(); }
+			};
+			
+			class tree_base0 : public std::conditional_t<with_stats::value, stats_holder, no_scope>{
+			protected:
+				tree_base0() : root(), stack(){
+					this->stack.push_back(nullptr);
+				}
+				// copies the structure as is, in O(N) without any comparisons or rotations
+				tree_base0(const tree_base0& t) : root(_clone(t.root)), stack(t.stack.size(), nullptr){}
+				tree_base0(tree_base0&&) = default;
+				tree_base0& operator=(const tree_base0& t){
+					if(this != &t){
+						this->root = _clone(t.root);
+						this->stack.assign(t.stack.size(), nullptr);
+					}
+					return *this;
+				}
+				tree_base0& operator=(tree_base0&&) = default;
+				inline static node_uptr _clone(const node_uptr& n){
+					if(!n){
+						return nullptr;
+					}
+					node_uptr c = std::make_unique<node>(static_cast<const node&>(*n));
+					c->l = _clone(n->l);
+					c->r = _clone(n->r);
+					return c;
+				}
+				/*
+					branch functions for nearest keys receive cmp, the result of comparing the key with cur.
+					a candidate found later in the descent is always nearer than the former one, so it is overwritten without comparisons
+				*/
+				inline static int _branch_ge(const node& cur, const node*& cand, int cmp){
+					if(cmp <= 0){
+						cand = &cur;
+					}
+					return cmp;
+				}
+				inline static int _branch_le(const node& cur, const node*& cand, int cmp){
+					if(cmp >= 0){
+						cand = &cur;
+					}
+					return cmp;
+				}
+				// the leftmost of the equal keys, for which the descent continues until a leaf
+				inline static int _branch_first_ge(const node& cur, const node*& cand, int cmp){
+					if(cmp <= 0){
+						cand = &cur;
+						return -1;
+					}else{
+						return 1;
+					}
+				}
+				inline static int _branch_gt(const node& cur, const node*& cand, int cmp){
+					if(cmp < 0){
+						cand = &cur;
+						return -1;
+					}else{
+						return 1;
+					}
+				}
+				inline static int _branch_lt(const node& cur, const node*& cand, int cmp){
+					if(cmp > 0){
+						cand = &cur;
+						return 1;
+					}else{
+						return -1;
+					}
+				}
+				template<typename KA> inline static branch_func _make_branch_eq(KA k){
+					return [q = query<KA>(k)](const node& cur){ return _compare(q, cur); };
+				}
+				template<int B(const node&, const node*&, int), typename KA> inline static branch_func _make_branch_find_func(const node*& cand, KA k){
+					return [&cand, q = query<KA>(k)](const node& cur){ return B(cur, cand, _compare(q, cur)); };
+				}
+				inline static branch_func _make_branch_l(){ return [](const node& cur){ return cur.l ? -1 : (cur.r ? 1 : 0); }; }
+				inline static branch_func _make_branch_r(){ return [](const node& cur){ return cur.r ? 1 : (cur.l ? -1 : 0); }; }
+				// on a hit, index is left as the position among the copies held by the node
+				inline static branch_func _make_branch_at(size_t& index){
+					return [&index](const node& cur){
+						const auto count_l = cur.l ? cur.l->c : 0;
+						if(index < count_l){
+							return -1;
+						}else if(index - count_l < cur.weight()){
+							index -= count_l;
+							return 0;
+						}else{
+							index -= count_l + cur.weight();
+							return 1;
+						}
+					};
+				}
+				inline static int _branch_calc_index(const node& cur, size_t& index, int cmp){
+					if(cmp >= 0){
+						if(cur.l){
+							index += cur.l->c;
+						}
+						if(cmp == 1){
+							index += cur.weight();
+						}
+					}
+					return cmp;
+				}
+				template <typename KA> inline static branch_func _make_branch_calc_index(size_t& index, KA k){
+					return [&index, q = query<KA>(k)](const node& cur){ return _branch_calc_index(cur, index, _compare(q, cur)); };
+				}
+				
+				node_uptr root;
+				std::vector<node_uptr*> stack;
+				
+				/*
+					operation counters, which cost nothing without with_stats
+				*/
+				template<typename... A> inline node_uptr _new_node(A&&... a){
+					if constexpr(with_stats::value){
+						this->_stats.allocations ++;
+					}
+					return std::make_unique<node>(std::forward<A>(a)...);
+				}
+				inline void _count_search(uint64_t visited, uint64_t comparisons_before) const{
+					if constexpr(with_stats::value){
+						this->_stats.nodes_visited += visited;
+						this->_stats.comparisons += _comparisons - comparisons_before;
+					}
+				}
+				inline auto _measure(latency_histogram operation_stats::* h) const{
+					if constexpr(with_latency::value){
+						return latency_scope(this->_stats.*h);
+					}else{
+						return no_scope();
+					}
+				}
+			
+				inline std::tuple<node_uptr&, size_t> _find(branch_func branch){
+					node_uptr* cur = &this->root;
+					size_t height = 0;
+					const uint64_t comparisons = with_stats::value ? _comparisons : 0;
+					while(*cur){
+						const auto b = branch(**cur);
+						if(b == 0){
+							break;
+						}
+						this->stack[height] = cur;
+						height ++;
+						if(b < 0){
+							cur = &(*cur)->l;
+						}else{
+							cur = &(*cur)->r;
+						}
+					}
+					_count_search(height + (*cur ? 1 : 0), comparisons);
+					return std::tuple_cat(std::tie(*cur), std::make_tuple(height));
+				}
+			
+				inline const node* _find(branch_func branch) const{
+					const node* cur = this->root.get();
+					uint64_t visited = 0;
+					const uint64_t comparisons = with_stats::value ? _comparisons : 0;
+					while(cur){
+						const auto b = branch(*cur);
+						visited ++;
+						if(b == 0){
+							break;
+						}else if(b < 0){
+							cur = cur->l.get();
+						}else{
+							cur = cur->r.get();
+						}
+					}
+					_count_search(visited, comparisons);
+					return cur;
+				}
+				
+				template<int B(const node&, const node*&, int), typename KA> inline const node* _find_nearest(KA k) const{
+					const node* cand = nullptr;
+					this->_find(tree_base0::template _make_branch_find_func<B, KA>(cand, k));
+					return cand;
+				}
+				
+#ifdef AVLTREE_DEBUG_CLASS
+				friend class AVLTREE_DEBUG_CLASS;
+#endif
+			};
+			
+			class tree_base_without_index : public tree_base0{
+			protected:
+				size_t _count;
+				tree_base_without_index() : tree_base0(), _count(0){}
+			public:
+				size_t size() const{ return _count; }
+			};
+			
+		public:
+			using iterator         = avltree<K, V, S, U, C>::iterator_base<true>;
+			using reverse_iterator = avltree<K, V, S, U, C>::iterator_base<false>;
+		private:
+			class tree_base_with_index : public tree_base0{
+			protected:
+				tree_base_with_index() : tree_base0(){}
+			public:
+				inline size_t size() const{ return this->root ? this->root->c : 0; }
+				
+				inline const node_view at(size_t index) const{ return node_view(this->_find(tree_base0::_make_branch_at(index))); }
+				inline iterator iterator_at(size_t index) const{ return iterator(this->stack.size(), this->root.get(), tree_base0::_make_branch_at(index), index); }
+				
+				template<typename Q = K> inline size_t index(const Q& k) const{
+					size_t index = 0;
+					const node* n = this->_find(tree_base0::template _make_branch_calc_index<QR<Q>>(index, k));
+					if(n && !_is_dead(*n)){
+						return index;
+					}else{
+						return size();
+					}
+				}
+				
+				template<int B(const node&, const node*&, int), typename KA> inline std::tuple<const node_view, size_t> _find_nearest_with_index(KA k) const {
+					const node* cand = nullptr;
+					size_t index = this->size(), index_tmp = 0;
+					const auto branch_base = tree_base0::template _make_branch_find_func<B, KA>(cand, k);
+					const auto branch = [&index, &index_tmp, &cand, branch_base](const node& cur){
+						const int b = branch_base(cur);
+						if(&cur == cand){
+							index = index_tmp + (cur.l ? cur.l->c : 0);
+						}
+						if(b >= 1){
+							index_tmp += cur.l ? cur.l->c : 0;
+							if(b == 1){
+								index_tmp += cur.weight();
+							}
+						}
+						return b;
+					};
+					this->_find(branch);
+					if constexpr(with_tombstone::value){
+						// a dead candidate gives way to the nearest alive node on the same side, which the index points to
+						if(cand && cand->dead){
+							if(B == tree_base0::_branch_le || B == tree_base0::_branch_lt){
+								index = index > 0 ? index - 1 : this->size();
+							}
+							size_t rest = index;
+							cand = this->_find(tree_base0::_make_branch_at(rest));
+						}
+					}
+					return std::make_tuple(node_view(cand), index);
+				}
+				
+				template<typename Q = K> inline std::tuple<const node_view, size_t> find_ge_with_index(const Q& k) const{ return _find_nearest_with_index<tree_base0::_branch_ge, QR<Q>>(k); }
+				template<typename Q = K> inline std::tuple<const node_view, size_t> find_gt_with_index(const Q& k) const{ return _find_nearest_with_index<tree_base0::_branch_gt, QR<Q>>(k); }
+				template<typename Q = K> inline std::tuple<const node_view, size_t> find_le_with_index(const Q& k) const{ return _find_nearest_with_index<tree_base0::_branch_le, QR<Q>>(k); }
+				template<typename Q = K> inline std::tuple<const node_view, size_t> find_lt_with_index(const Q& k) const{ return _find_nearest_with_index<tree_base0::_branch_lt, QR<Q>>(k); }
+			};
+			
+			using tree_base1 = std::conditional_t<with_index::value, tree_base_with_index, tree_base_without_index>;
+			
+			class tree_base_with_generation : public tree_base1{
+			protected:
+				uint64_t _generation; // nodes marked with the current generation are modified after the last checkpoint_delta()
+				tree_base_with_generation() : tree_base1(), _generation(1){}
+			};
+			
+			using tree_base1g = std::conditional_t<with_generation::value, tree_base_with_generation, tree_base1>;
+			
+			class tree_base_with_extremes : public tree_base1g{
+			protected:
+				// the leftmost and the rightmost nodes. nodes never move in rotations, so only linking and unlinking update them
+				const node* _first;
+				const node* _last;
+				tree_base_with_extremes() : tree_base1g(), _first(nullptr), _last(nullptr){}
+				tree_base_with_extremes(const tree_base_with_extremes& t) : tree_base1g(t){ _find_extremes(); }
+				tree_base_with_extremes(tree_base_with_extremes&& t) : tree_base1g(std::move(t)), _first(std::exchange(t._first, nullptr)), _last(std::exchange(t._last, nullptr)){}
+				tree_base_with_extremes& operator=(const tree_base_with_extremes& t){
+					tree_base1g::operator=(t);
+					_find_extremes();
+					return *this;
+				}
+				tree_base_with_extremes& operator=(tree_base_with_extremes&& t){
+					tree_base1g::operator=(std::move(t));
+					_first = std::exchange(t._first, nullptr);
+					_last = std::exchange(t._last, nullptr);
+					return *this;
+				}
+				inline void _find_extremes(){
+					_first = _last = this->root.get();
+					while(_first && _first->l){
+						_first = _first->l.get();
+					}
+					while(_last && _last->r){
+						_last = _last->r.get();
+					}
+				}
+				
+#ifdef AVLTREE_DEBUG_CLASS
+				friend class AVLTREE_DEBUG_CLASS;
+#endif
+			};
+			
+			using tree_base1e = std::conditional_t<with_extremes::value, tree_base_with_extremes, tree_base1g>;
+			
+			class tree_base_with_hash_index : public tree_base1e{
+				// the keys found by the hash are equal by C, which must agree with std::hash<K>
+				static_assert(std::is_same_v<C, std::less<K>> || std::is_same_v<C, std::less<>> || std::is_same_v<C, std::greater<K>> || std::is_same_v<C, std::greater<>>, "invalid tree_spec: with_hash_index hashes keys by std::hash<K>, so it requires std::less or std::greater as the comparator");
+			protected:
+				struct hash_slot{
+					size_t h;
+					const node* n;
+				};
+				// open addressing from the keys to the nodes by linear probing, at most 3/4 full.
+				// erasing shifts the following entries back instead of leaving tombstones
+				std::vector<hash_slot> _slots;
+				size_t _hashed;
+				tree_base_with_hash_index() : tree_base1e(), _slots(), _hashed(0){}
+				tree_base_with_hash_index(const tree_base_with_hash_index& t) : tree_base1e(t), _slots(), _hashed(0){ _rehash(); }
+				tree_base_with_hash_index(tree_base_with_hash_index&& t) : tree_base1e(std::move(t)), _slots(std::move(t._slots)), _hashed(std::exchange(t._hashed, 0)){
+					t._slots.clear();
+				}
+				tree_base_with_hash_index& operator=(const tree_base_with_hash_index& t){
+					tree_base1e::operator=(t);
+					_rehash();
+					return *this;
+				}
+				tree_base_with_hash_index& operator=(tree_base_with_hash_index&& t){
+					tree_base1e::operator=(std::move(t));
+					_slots = std::move(t._slots);
+					t._slots.clear();
+					_hashed = std::exchange(t._hashed, 0);
+					return *this;
+				}
+				// std::hash is often the identity for integers, so the bits are mixed before masking
+				inline static size_t _hash(const K& k){
+					uint64_t h = std::hash<K>()(k);
+					h ^= h >> 33;
+					h *= 0xff51afd7ed558ccdULL;
+					h ^= h >> 33;
+					return (size_t)h;
+				}
+				inline void _place(const hash_slot& e){
+					const size_t mask = _slots.size() - 1;
+					size_t i = e.h & mask;
+					while(_slots[i].n){
+						i = (i + 1) & mask;
+					}
+					_slots[i] = e;
+				}
+				inline void _resize(size_t capacity){
+					std::vector<hash_slot> old(capacity, hash_slot{0, nullptr});
+					std::swap(old, _slots);
+					for(const auto& e: old){
+						if(e.n){
+							_place(e);
+						}
+					}
+				}
+				inline void _hash_insert(const node* n){
+					if((_hashed + 1) * 4 > _slots.size() * 3){
+						_resize(std::max<size_t>(_slots.size() * 2, 16));
+					}
+					_place(hash_slot{_hash(n->key()), n});
+					_hashed ++;
+				}
+				inline void _hash_erase(const node* n){
+					const size_t mask = _slots.size() - 1;
+					size_t i = _hash(n->key()) & mask;
+					while(_slots[i].n != n){
+						i = (i + 1) & mask;
+					}
+					// an entry after the hole moves into it, unless its home slot lies between the hole and itself
+					for(size_t j = (i + 1) & mask; _slots[j].n; j = (j + 1) & mask){
+						if(((j - (_slots[j].h & mask)) & mask) >= ((j - i) & mask)){
+							_slots[i] = _slots[j];
+							i = j;
+						}
+					}
+					_slots[i] = hash_slot{0, nullptr};
+					_hashed --;
+				}
+				inline void _hash_erase_subtree(const node* n){
+					if(n){
+						_hash_erase_subtree(n->l.get());
+						_hash_erase_subtree(n->r.get());
+						_hash_erase(n);
+					}
+				}
+				inline void _hash_insert_subtree(const node* n){
+					if(n){
+						_hash_insert_subtree(n->l.get());
+						_hash_insert_subtree(n->r.get());
+						_hash_insert(n);
+					}
+				}
+				inline void _rehash(){
+					_slots.clear();
+					_hashed = 0;
+					_hash_insert_subtree(this->root.get());
+				}
+				// the node n was replaced with its copy m
+				inline void _hash_move(const node* n, const node* m){
+					const size_t mask = _slots.size() - 1;
+					size_t i = _hash(n->key()) & mask;
+					while(_slots[i].n != n){
+						i = (i + 1) & mask;
+					}
+					_slots[i].n = m;
+				}
+				inline const node* _hash_find(const K& k) const{
+					if(_slots.empty()){
+						return nullptr;
+					}
+					const size_t mask = _slots.size() - 1;
+					const size_t h = _hash(k);
+					for(size_t i = h & mask; _slots[i].n; i = (i + 1) & mask){
+						if(_slots[i].h == h && _compare(k, _slots[i].n->key()) == 0){
+							return _slots[i].n;
+						}
+					}
+					return nullptr;
+				}
+			public:
+				inline size_t hash_index_capacity() const{ return _slots.size(); }
+			};
+			
+			using tree_base1h = std::conditional_t<with_hash_index::value, tree_base_with_hash_index, tree_base1e>;
+			
+			class tree_base_with_tombstone : public tree_base1h{
+			protected:
+				size_t _dead;       // removed nodes left in the tree
+				double _dead_ratio; // the tree is compacted once the dead nodes exceed this ratio of all nodes
+				tree_base_with_tombstone() : tree_base1h(), _dead(0), _dead_ratio(0.25){}
+				tree_base_with_tombstone(const tree_base_with_tombstone&) = default;
+				tree_base_with_tombstone(tree_base_with_tombstone&& t) : tree_base1h(std::move(t)), _dead(std::exchange(t._dead, 0)), _dead_ratio(t._dead_ratio){}
+				tree_base_with_tombstone& operator=(const tree_base_with_tombstone&) = default;
+				tree_base_with_tombstone& operator=(tree_base_with_tombstone&& t){
+					tree_base1h::operator=(std::move(t));
+					_dead = std::exchange(t._dead, 0);
+					_dead_ratio = t._dead_ratio;
+					return *this;
+				}
+			public:
+				// number of the removed nodes waiting for the next compaction
+				inline size_t tombstones() const{ return _dead; }
+				// removals compact the tree once the dead nodes exceed the ratio r of all nodes. with r >= 1, only compact() does
+				inline void set_tombstone_ratio(double r){ _dead_ratio = r; }
+				
+#ifdef AVLTREE_DEBUG_CLASS
+				friend class AVLTREE_DEBUG_CLASS;
+#endif
+			};
+			
+			using tree_base1t = std::conditional_t<with_tombstone::value, tree_base_with_tombstone, tree_base1h>;
+
+		public:
+			/*
+				FLAT IMAGE : a read-only tree in a contiguous buffer, which can be shared between processes by mapping the same file
+				the records are sorted, and the root of the range [lo, hi) is at (lo + hi) / 2, so the nodes hold no links
+			*/
+			struct image_record_base{
+				data_type data;
+				uint64_t c; // number of the elements in the subtree
+			};
+			struct image_record_with_summary : public image_record_base{
+				typename summarizer::type s;
+			};
+			using image_record = std::conditional_t<with_summary::value, image_record_with_summary, image_record_base>;
+			template<typename T> using is_flat = std::conjunction<std::is_trivially_copy_constructible<T>, std::is_trivially_destructible<T>>;
+			
+			struct image_header{
+				char magic[4];
+				uint32_t version;
+				uint32_t record_size;
+				uint32_t multiplicity;
+				uint64_t n;
+				uint64_t reserved;
+			};
+			inline static const uint32_t image_version = 1;
+			
+			class image_view{
+				const image_record* records;
+				size_t n;
+				inline static KR _key(const image_record& r){
+					if constexpr(with_value::value){
+						return r.data.first;
+					}else{
+						return r.data;
+					}
+				}
+				inline size_t _count(size_t lo, size_t hi) const{ return lo < hi ? records[(lo + hi) / 2].c : 0; }
+				// the first position whose key is not less than k, or greater than k if G is true
+				template<bool G, typename KA> inline size_t _bound(KA k) const{
+					size_t lo = 0, hi = n;
+					while(lo < hi){
+						const size_t mid = (lo + hi) / 2;
+						const int cmp = _compare(k, _key(records[mid]));
+						if(cmp < 0 || (!G && cmp == 0)){
+							hi = mid;
+						}else{
+							lo = mid + 1;
+						}
+					}
+					return lo;
+				}
+				// number of the elements before the position p
+				inline size_t _prefix(size_t p) const{
+					if constexpr(!with_multiplicity::value){
+						return p;
+					}
+					size_t lo = 0, hi = n, prefix = 0;
+					while(lo < hi){
+						const size_t mid = (lo + hi) / 2;
+						if(p <= mid){
+							hi = mid;
+						}else{
+							prefix += records[mid].c - _count(mid + 1, hi);
+							lo = mid + 1;
+						}
+					}
+					return prefix;
+				}
+				// position of the record holding the index-th element
+				inline size_t _position(size_t index) const{
+					if constexpr(!with_multiplicity::value){
+						return std::min(index, n);
+					}
+					size_t lo = 0, hi = n;
+					while(lo < hi){
+						const size_t mid = (lo + hi) / 2;
+						const size_t cl = _count(lo, mid);
+						const size_t w = records[mid].c - cl - _count(mid + 1, hi);
+						if(index < cl){
+							hi = mid;
+						}else if(index - cl < w){
+							return mid;
+						}else{
+							index -= cl + w;
+							lo = mid + 1;
+						}
+					}
+					return n;
+				}
+				inline const data_type* _get(size_t p) const{ return p < n ? &records[p].data : nullptr; }
+				typename summarizer::type _summarize(size_t lo, size_t hi, size_t l, size_t r) const{
+					if(l >= r || lo >= hi){
+						return summarizer::identity_();
+					}
+					const size_t mid = (lo + hi) / 2;
+					const image_record& cur = records[mid];
+					if(l == 0 && r >= cur.c){
+						return cur.s;
+					}
+					typename summarizer::type summary(summarizer::identity_());
+					const size_t cl = _count(lo, mid);
+					const size_t cm = cur.c - _count(mid + 1, hi);
+					if(l < cl){
+						summarizer::accumulate_(summary, _summarize(lo, mid, l, r));
+					}
+					if(l < cm && r > cl){
+						if constexpr(with_multiplicity::value){
+							summarizer::accumulate_(summary, summarizer::repeat_(summarizer::get_(cur.data), std::min(r, cm) - std::max(l, cl)));
+						}else{
+							summarizer::accumulate_(summary, summarizer::get_(cur.data));
+						}
+					}
+					if(r > cm){
+						summarizer::accumulate_(summary, _summarize(mid + 1, hi, l > cm ? l - cm : 0, r - cm));
+					}
+					return summary;
+				}
+			public:
+				image_view(): records(nullptr), n(0){}
+				// p points the image written by save_image(), and has to be aligned as image_record. an invalid image makes an empty view
+				image_view(const void* p, size_t bytes): records(nullptr), n(0){
+					const image_header* h = reinterpret_cast<const image_header*>(p);
+					if(bytes < sizeof(image_header) || reinterpret_cast<std::uintptr_t>(p) % alignof(image_record) != 0 || std::string_view(h->magic, 4) != "AVLI"){
+						return;
+					}
+					if(h->version != image_version || h->record_size != sizeof(image_record) || h->multiplicity != with_multiplicity::value){
+						return;
+					}
+					if(h->n > (bytes - sizeof(image_header)) / sizeof(image_record)){
+						return;
+					}
+					records = reinterpret_cast<const image_record*>(h + 1);
+					n = h->n;
+				}
+				inline bool valid() const{ return records != nullptr; }
+				inline size_t size() const{ return _count(0, n); }
+				
+				template<typename Q = K> inline const data_type* find(const Q& k) const{
+					const size_t p = _bound<false, QR<Q>>(k);
+					return p < n && _compare<QR<Q>>(k, _key(records[p])) == 0 ? &records[p].data : nullptr;
+				}
+				template<typename Q = K> inline bool contains(const Q& k) const{ return find<Q>(k) != nullptr; }
+				template<typename Q = K> inline const data_type* find_ge(const Q& k) const{ return _get(_bound<false, QR<Q>>(k)); }
+				template<typename Q = K> inline const data_type* find_gt(const Q& k) const{ return _get(_bound<true, QR<Q>>(k)); }
+				template<typename Q = K> inline const data_type* find_le(const Q& k) const{ return _get(_bound<true, QR<Q>>(k) - 1); }
+				template<typename Q = K> inline const data_type* find_lt(const Q& k) const{ return _get(_bound<false, QR<Q>>(k) - 1); }
+				
+				inline const data_type* at(size_t index) const{ return _get(_position(index)); }
+				// index of the first element equal to k, or size() if not found
+				template<typename Q = K> inline size_t index(const Q& k) const{ return find<Q>(k) ? _prefix(_bound<false, QR<Q>>(k)) : size(); }
+				
+				template<typename Q = K> inline typename summarizer::type summarize(const Q& l, const Q& r) const{
+					return summarize_by_index(_prefix(_bound<false, QR<Q>>(l)), _prefix(_bound<true, QR<Q>>(r)));
+				}
+				inline typename summarizer::type summarize_by_index(size_t l, size_t r) const{ return _summarize(0, n, l, r); }
+			};
+			
+			
+			class tree_base2 : public tree_base1t{
+				template<node_uptr& L(node&), node_uptr& R(node&), int D> inline void _rotate(node_uptr& p1){
+					node_uptr& p2 = L(*p1);
+					node_uptr& p3 = R(*p2);
+					if(p2->balance() == -D){
+						if constexpr(with_stats::value){
+							this->_stats.double_rotations ++;
+						}
+						node_uptr& p4 = L(*p3);
+						node_uptr& p5 = R(*p3);
+						const auto p3b = p3->balance();
+						swap(p1, p3);
+						swap(p2, p5);
+						swap(p3, p4);
+						swap(p4, p5);
+						if constexpr(with_depth::value){
+							p4->reset_depth();
+							p5->reset_depth();
+							p1->reset_depth();
+						}else{
+							p1->b = 0;
+							if(p3b == 0){
+								p4->b = 0;
+								p5->b = 0;
+							}else if(p3b == D){
+								p4->b = 0;
+								p5->b = -D;
+							}else{
+								p4->b = D;
+								p5->b = 0;
+							}
+						}
+						_mark(*p4);
+						_mark(*p5);
+						_mark(*p1);
+						if constexpr(with_index::value){
+							p4->update_count();
+							p5->update_count();
+							p1->update_count();
+						}
+						if constexpr(with_summary::value){
+							p4->update_summary();
+							p5->update_summary();
+							p1->update_summary();
+						}
+					}else{
+						if constexpr(with_stats::value){
+							this->_stats.single_rotations ++;
+						}
+						swap(p1, p2);
+						swap(p2, p3);
+						if constexpr(with_depth::value){
+							p3->reset_depth();
+							p1->reset_depth();
+						}else{
+							p1->b -= D;
+							if(p1->b == 0){
+								p3->b = 0;
+							}else{
+								p3->b = D;
+							}
+						}
+						_mark(*p3);
+						_mark(*p1);
+						if constexpr(with_index::value){
+							p3->update_count();
+							p1->update_count();
+						}
+						if constexpr(with_summary::value){
+							p3->update_summary();
+							p1->update_summary();
+						}
+					}
+				}
+				
+				/*
+					generation marks: every node whose subtree changed is marked, so unchanged subtrees can be skipped as a whole
+				*/
+				inline void _mark(node& n){
+					if constexpr(with_generation::value){
+						n.g = this->_generation;
+					}
+				}
+				inline void _mark_path(node* n, size_t height){
+					if constexpr(with_generation::value){
+						if(n){
+							_mark(*n);
+						}
+						for(size_t i = 0; i < height; i ++){
+							_mark(**this->stack[i]);
+						}
+					}
+				}
+				
+				inline static node_uptr& get_l(node& node){ return node.l; }
+				inline static node_uptr& get_r(node& node){ return node.r; }
+				inline void _rotate_lr(node_uptr& p1){ _rotate<get_l, get_r, 1>(p1); }
+				inline void _rotate_rl(node_uptr& p1){ _rotate<get_r, get_l, -1>(p1); }
+			protected:
+				template <typename K_> inline bool _insert(K_&& k){
+					[[maybe_unused]] const auto scope = this->_measure(&operation_stats::insert);
+					auto [new_node, height] = this->_find(tree_base0::template _make_branch_eq<KR>(k));
+					if(new_node){
+						return _revive(*new_node, height);
+					}
+					new_node = this->_new_node(std::forward<K_>(k));
+					_fix_balance<1>(new_node, height);
+					return true;
+				}
+				template <typename K_, typename V_> inline bool _insert(K_&& k, V_&& v){
+					[[maybe_unused]] const auto scope = this->_measure(&operation_stats::insert);
+					auto [new_node, height] = this->_find(tree_base0::template _make_branch_eq<KR>(k));
+					if(new_node){
+						new_node->value() = std::forward<V_>(v);
+						if(_revive(*new_node, height)){
+							return true;
+						}
+						_update_path(*new_node, height, 0);
+						return false;
+					}
+					new_node = this->_new_node(std::forward<K_>(k), std::forward<V_>(v));
+					_fix_balance<1>(new_node, height);
+					return true;
+				}
+				// constructs the value in place only if k is not contained
+				template <typename K_, typename... A> inline bool _try_emplace(K_&& k, A&&... a){
+					[[maybe_unused]] const auto scope = this->_measure(&operation_stats::insert);
+					auto [new_node, height] = this->_find(tree_base0::template _make_branch_eq<KR>(k));
+					if(new_node){
+						if constexpr(with_tombstone::value){
+							if(new_node->dead){
+								new_node->value() = V(std::forward<A>(a)...);
+								return _revive(*new_node, height);
+							}
+						}
+						return false;
+					}
+					new_node = this->_new_node(std::piecewise_construct, std::forward_as_tuple(std::forward<K_>(k)), std::forward_as_tuple(std::forward<A>(a)...));
+					_fix_balance<1>(new_node, height);
+					return true;
+				}
+				// for with_multiplicity: adds a copy to the node of k if exists
+				template <typename K_> inline bool _insert_copy(K_&& k){
+					[[maybe_unused]] const auto scope = this->_measure(&operation_stats::insert);
+					auto [new_node, height] = this->_find(tree_base0::template _make_branch_eq<KR>(k));
+					if(new_node){
+						new_node->m ++;
+						_update_path(*new_node, height, 1);
+						return true;
+					}
+					new_node = this->_new_node(std::forward<K_>(k));
+					_fix_balance<1>(new_node, height);
+					return true;
+				}
+				/*
+					relinking detached nodes, without allocation
+				*/
+				// clears the links and the cached values of the node detached from a tree
+				inline static void _reset(node& n){
+					n.l.reset();
+					n.r.reset();
+					if constexpr(with_depth::value){
+						n.h = 1;
+					}else if constexpr(!with_wavl::value){
+						n.b = 0;
+					}
+					if constexpr(with_wavl::value){
+						n.rank = 0;
+					}
+					if constexpr(with_index::value){
+						n.c = n.weight();
+					}
+					if constexpr(with_key_prefix::value){
+						n.p = _digest(n.key());
+					}
+					if constexpr(with_summary::value){
+						n.update_summary();
+					}
+				}
+				// moves the links and the balance of n to s, which takes the place of n in the tree.
+				// the count of s is that of n, so the ancestors are recounted from the children where the weights of s and n may differ
+				inline static void _take_place(node& s, node& n){
+					s.l = std::move(n.l);
+					s.r = std::move(n.r);
+					if constexpr(with_depth::value){
+						s.h = n.h;
+					}else if constexpr(!with_wavl::value){
+						s.b = n.b;
+					}
+					if constexpr(with_wavl::value){
+						s.rank = n.rank;
+					}
+					if constexpr(with_index::value){
+						s.c = n.c;
+					}
+				}
+				/*
+					relocation for relayout. the memory of all the copies is allocated in the given order before any payload is moved or any node is freed.
+					_relocate() constructs the copy of o there, moving the payload if it cannot throw, moves the children of o to the copy and holds the copy in o->l.
+					_adopt() replaces o at the slot with the copy
+				*/
+				inline static void* _allocate_node(){
+					if constexpr(with_arena::value){
+						return node::operator new(sizeof(node));
+					}else{
+						return ::operator new(sizeof(node));
+					}
+				}
+				inline static void _deallocate_node(void* p){
+					if constexpr(with_arena::value){
+						node::deleting_from_arena = node::arena != nullptr;
+						node::operator delete(p);
+					}else{
+						::operator delete(p);
+					}
+				}
+				inline node* _relocate(node& o, void* p){
+					node* c = ::new(p) node(std::move_if_noexcept(o.data));
+					if constexpr(with_stats::value){
+						this->_stats.allocations ++;
+					}
+					if constexpr(with_multiplicity::value){
+						c->m = o.m;
+					}else if constexpr(with_tombstone::value){
+						c->dead = o.dead;
+					}
+					if constexpr(with_generation::value){
+						c->g = o.g;
+					}
+					if constexpr(with_summary::value){
+						c->s = std::move(o.s);
+					}
+					_take_place(*c, o);
+					o.l.reset(c);
+					return c;
+				}
+				inline void _adopt(node_uptr& slot){
+					if constexpr(with_hash_index::value){
+						this->_hash_move(slot.get(), slot->l.get());
+					}
+					slot = std::move(slot->l);
+				}
+				// moves the nodes in order into new ones, and replaces them with the new ones. depth[i] is that of order[i], whose children are also in order if they are shallower than levels
+				void _relayout(node_uptr& top, const std::vector<node*>& order, const std::vector<size_t>& depth, size_t levels){
+					std::vector<void*> memory;
+					memory.reserve(order.size());
+					std::vector<node*> copies;
+					copies.reserve(order.size());
+					[[maybe_unused]] avltree_base::node_arena* arena = nullptr;
+					if constexpr(with_arena::value){
+						arena = node::arena;
+					}
+					const bool seq = arena ? arena->sequential(true) : false;
+					try{
+						for(size_t i = 0; i < order.size(); i ++){
+							memory.push_back(_allocate_node());
+						}
+						for(node* o: order){
+							copies.push_back(_relocate(*o, memory[copies.size()]));
+						}
+					}catch(...){
+						// only a copy of the payload may throw after the allocation, so the payloads of the copies made so far are still in the originals.
+						// moves the children back, and frees the copies and the memory not used yet
+						for(size_t i = copies.size(); i -- > 0; ){
+							node_uptr c = std::move(order[i]->l);
+							_take_place(*order[i], *c);
+							if constexpr(with_summary::value){
+								order[i]->s = std::move(c->s);
+							}
+						}
+						for(size_t i = copies.size(); i < memory.size(); i ++){
+							_deallocate_node(memory[i]);
+						}
+						if(arena){
+							arena->sequential(seq);
+						}
+						throw;
+					}
+					if(arena){
+						arena->sequential(seq);
+					}
+					for(size_t i = 0; i < copies.size(); i ++){
+						if(depth[i] + 1 < levels){
+							if(copies[i]->l){
+								_adopt(copies[i]->l);
+							}
+							if(copies[i]->r){
+								_adopt(copies[i]->r);
+							}
+						}
+					}
+					_adopt(top);
+					_reset_extremes();
+				}
+				inline void _link(node_uptr& slot, node_uptr&& n, size_t height){
+					_reset(*n);
+					if constexpr(with_multiplicity::value && !with_index::value){
+						// _fix_balance counts a node as one element
+						this->_count += n->m - 1;
+					}
+					slot = std::move(n);
+					_fix_balance<1>(slot, height);
+				}
+				// for unique keys: links n if its key is not contained, or else overwrites the value (for map) and discards n
+				inline bool _insert_node(node_uptr&& n){
+					if(!n){
+						return false;
+					}
+					[[maybe_unused]] const auto scope = this->_measure(&operation_stats::insert);
+					auto [slot, height] = this->_find(tree_base0::template _make_branch_eq<KR>(n->key()));
+					if(slot){
+						if constexpr(with_value::value){
+							slot->value() = std::move(n->value());
+						}
+						if(_revive(*slot, height)){
+							return true;
+						}
+						if constexpr(with_value::value){
+							_update_path(*slot, height, 0);
+						}
+						return false;
+					}
+					_link(slot, std::move(n), height);
+					return true;
+				}
+				inline bool _insert_node(node_uptr_view&& n){ return _insert_node(_release(std::move(n))); }
+				template<typename... A> inline bool _emplace(A&&... a){ return _insert_node(this->_new_node(std::forward<A>(a)...)); }
+				// refreshes count and summary of the node and its ancestors on the stack, after the weight of the node changed by d
+				inline void _update_path(node& n, size_t height, std::ptrdiff_t d){
+					_mark_path(&n, height);
+					if constexpr(!with_index::value){
+						this->_count += d;
+					}
+					if constexpr(with_index::value || with_summary::value){
+						if constexpr(with_index::value){
+							n.c += d;
+						}
+						if constexpr(with_summary::value){
+							n.update_summary();
+						}
+						while(height > 0){
+							height --;
+							node& parent = **this->stack[height];
+							if constexpr(with_index::value){
+								parent.c += d;
+							}
+							if constexpr(with_summary::value){
+								parent.update_summary();
+							}
+						}
+					}
+				}
+				/*
+					tombstones: a removed node is only marked dead, and left in the tree with weight 0 until compact()
+				*/
+				// brings the dead node back in place of a new one, and refreshes its ancestors on the stack
+				inline bool _revive(node& n, size_t height){
+					if constexpr(with_tombstone::value){
+						if(n.dead){
+							n.dead = false;
+							this->_dead --;
+							_update_path(n, height, 1);
+							return true;
+						}
+					}
+					return false;
+				}
+				// marks the node found by branch dead instead of unlinking it, and compacts the tree once the dead nodes are too many
+				bool _bury(branch_func branch){
+					[[maybe_unused]] const auto scope = this->_measure(&operation_stats::remove);
+					auto [n, height] = this->_find(branch);
+					if(!n || n->dead){
+						return false;
+					}
+					n->dead = true;
+					this->_dead ++;
+					_update_path(*n, height, -1);
+					if((double)this->_dead > this->_dead_ratio * (double)(this->size() + this->_dead)){
+						compact();
+					}
+					return true;
+				}
+				// moves the alive nodes in order to nodes, and frees the dead ones
+				inline static void _collect_alive(node_uptr n, std::vector<node_uptr>& nodes){
+					if(n){
+						_collect_alive(std::move(n->l), nodes);
+						node_uptr r = std::move(n->r);
+						if(!n->dead){
+							nodes.push_back(std::move(n));
+						}
+						_collect_alive(std::move(r), nodes);
+					}
+				}
+				// whether the key of the node at the slot can be overwritten with k in place, i.e. k is still between its neighbors
+				inline bool _fits(const node_uptr& slot, size_t height, const K& k) const{
+					const node* lower = slot->l ? _edge<true>(slot->l.get()) : nullptr;
+					const node* upper = slot->r ? _edge<false>(slot->r.get()) : nullptr;
+					const node* child = slot.get();
+					for(size_t i = height; i > 0 && !(lower && upper); i --){
+						const node* parent = this->stack[i - 1]->get();
+						if(parent->l.get() == child){
+							upper = upper ? upper : parent;
+						}else{
+							lower = lower ? lower : parent;
+						}
+						child = parent;
+					}
+					return (!lower || _compare(lower->key(), k) <= 0) && (!upper || _compare(k, upper->key()) <= 0);
+				}
+				/*
+					building a balanced tree from sorted nodes, in O(N)
+				*/
+				// links the next n nodes given by next() in order, and stores the height of the subtree. next() returns nullptr on failure
+				template<typename F> inline node_uptr _build(size_t n, size_t& height, F& next){
+					if(n == 0){
+						height = 0;
+						return nullptr;
+					}
+					size_t hl, hr;
+					node_uptr l = _build(n / 2, hl, next);
+					node_uptr cur = next();
+					if(!cur){
+						height = 0;
+						return nullptr;
+					}
+					node_uptr r = _build(n - 1 - n / 2, hr, next);
+					cur->l = std::move(l);
+					cur->r = std::move(r);
+					height = std::max(hl, hr) + 1;
+					if constexpr(with_depth::value){
+						cur->h = height;
+					}else if constexpr(!with_wavl::value){
+						cur->b = (int)hl - (int)hr;
+					}
+					if constexpr(with_wavl::value){
+						cur->rank = (int)height - 1;
+					}
+					if constexpr(with_index::value){
+						cur->update_count();
+					}else{
+						this->_count += cur->weight();
+					}
+					if constexpr(with_summary::value){
+						cur->update_summary();
+					}
+					return cur;
+				}
+				template<typename F> inline void _assign_sorted(size_t n, F&& next){
+					size_t height;
+					if constexpr(!with_index::value){
+						this->_count = 0;
+					}
+					this->root = _build(n, height, next);
+					_reset_extremes();
+					if constexpr(with_hash_index::value){
+						this->_rehash();
+					}
+					if(this->stack.size() <= height){
+						this->stack.resize(height + 1, nullptr);
+					}
+				}
+				/*
+					binary snapshot
+				*/
+				inline static const uint32_t snapshot_version = 1;
+				template<typename T> inline static void _write(std::ostream& os, const T& x){ os.write(reinterpret_cast<const char*>(&x), sizeof(T)); }
+				template<typename T> inline static bool _read(std::istream& is, T& x){ return (bool)is.read(reinterpret_cast<char*>(&x), sizeof(T)); }
+				// reads size bytes in pieces, so that a broken size allocates no more than the stream holds
+				inline static bool _read_bytes(std::istream& is, std::string& bytes, uint32_t size){
+					const uint32_t piece = 1 << 16;
+					bytes.clear();
+					for(uint32_t done = 0; done < size; done += piece){
+						const uint32_t n = std::min(piece, size - done);
+						bytes.resize(done + n);
+						if(!is.read(bytes.data() + done, n)){
+							return false;
+						}
+					}
+					return true;
+				}
+				// calls f for each node in order
+				template<typename F> inline static void _for_each_node(const node* n, F&& f){
+					if(n){
+						_for_each_node(n->l.get(), f);
+						f(*n);
+						_for_each_node(n->r.get(), f);
+					}
+				}
+				inline static void _fill_image(std::vector<image_record>& records, const std::vector<const node*>& nodes, size_t lo, size_t hi){
+					if(lo >= hi){
+						return;
+					}
+					const size_t mid = (lo + hi) / 2;
+					image_record& cur = records[mid];
+					_fill_image(records, nodes, lo, mid);
+					_fill_image(records, nodes, mid + 1, hi);
+					cur.data = nodes[mid]->data;
+					cur.c = nodes[mid]->weight();
+					if constexpr(with_summary::value){
+						cur.s = summarizer::identity_();
+						if(lo < mid){
+							summarizer::accumulate_(cur.s, records[(lo + mid) / 2].s);
+						}
+						summarizer::accumulate_(cur.s, nodes[mid]->own_summary());
+						if(mid + 1 < hi){
+							summarizer::accumulate_(cur.s, records[(mid + 1 + hi) / 2].s);
+						}
+					}
+					if(lo < mid){
+						cur.c += records[(lo + mid) / 2].c;
+					}
+					if(mid + 1 < hi){
+						cur.c += records[(mid + 1 + hi) / 2].c;
+					}
+				}
+				inline static size_t _count_nodes(const node* n){ return n ? _count_nodes(n->l.get()) + _count_nodes(n->r.get()) + 1 : 0; }
+				inline static void _save_node(std::ostream& os, const node& n){
+					if(n.l){
+						_save_node(os, *n.l);
+					}
+					if(!_is_dead(n)){
+						_write(os, n.key());
+						if constexpr(with_value::value){
+							_write(os, n.value());
+						}
+						if constexpr(with_multiplicity::value){
+							_write(os, (uint64_t)n.m);
+						}
+					}
+					if(n.r){
+						_save_node(os, *n.r);
+					}
+				}
+				inline void _clear(){
+					this->root.reset();
+					if constexpr(with_tombstone::value){
+						this->_dead = 0;
+					}
+					_reset_extremes();
+					if constexpr(with_hash_index::value){
+						this->_rehash();
+					}
+					if constexpr(!with_index::value){
+						this->_count = 0;
+					}
+				}
+				// builds the tree from n sorted nodes given by make(), which returns nullptr on failure. equal keys are accepted only if allow_equal is true
+				// the first failure stops the build, which frees the nodes built so far, so make() is never called after that
+				template<typename F> bool _assign_checked(size_t n, bool allow_equal, F&& make){
+					const node* prev = nullptr;
+					size_t count = 0;
+					bool failed = false;
+					auto next = [&make, &prev, &count, &failed, allow_equal]() -> node_uptr {
+						if(failed){
+							return nullptr;
+						}
+						node_uptr cur = make();
+						if(!cur){
+							failed = true;
+							return nullptr;
+						}
+						if(prev){
+							const int cmp = _compare(prev->key(), cur->key());
+							if(cmp > 0 || (cmp == 0 && !allow_equal)){
+								failed = true;
+								return nullptr;
+							}
+						}
+						prev = cur.get();
+						count ++;
+						return cur;
+					};
+					_assign_sorted(n, next);
+					if(count != n){
+						_clear();
+						return false;
+					}
+					return true;
+				}
+				// replaces the contents with the snapshot
+				bool _load(std::istream& is, bool allow_equal){
+					_clear();
+					char magic[4];
+					uint32_t version, key_size, value_size, multiplicity;
+					uint64_t n;
+					if(!_read(is, magic) || std::string_view(magic, 4) != "AVLT" || !_read(is, version) || version != snapshot_version){
+						return false;
+					}
+					if(!_read(is, key_size) || !_read(is, value_size) || !_read(is, multiplicity) || !_read(is, n)){
+						return false;
+					}
+					if(key_size != sizeof(K) || value_size != (with_value::value ? sizeof(V) : 0) || multiplicity != with_multiplicity::value){
+						return false;
+					}
+					return _assign_checked(n, allow_equal, [&is]() -> node_uptr {
+						K k;
+						if(!_read(is, k)){
+							return nullptr;
+						}
+						node_uptr cur;
+						if constexpr(with_value::value){
+							V v;
+							if(!_read(is, v)){
+								return nullptr;
+							}
+							cur = std::make_unique<node>(std::move(k), std::move(v));
+						}else{
+							cur = std::make_unique<node>(std::move(k));
+						}
+						if constexpr(with_multiplicity::value){
+							uint64_t m;
+							if(!_read(is, m) || m == 0){
+								return nullptr;
+							}
+							cur->m = m;
+						}
+						return cur;
+					});
+				}
+				/*
+					compressed stream : chunks of encoded records, each of which is led by the number of the records, the size and the checksum
+				*/
+				inline static const uint32_t stream_version = 1;
+				inline static const size_t stream_chunk_size = 4096;
+				inline static uint32_t _checksum(const std::string& bytes){
+					// FNV-1a
+					uint32_t h = 2166136261u;
+					for(const char c: bytes){
+						h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+					}
+					return h;
+				}
+				inline static const K* _key_of(const node* n){
+					if constexpr(with_value::value){
+						return n ? &n->data.first : nullptr;
+					}else{
+						return n ? &n->data : nullptr;
+					}
+				}
+				inline static const V* _value_of(const node* n){ return n ? &n->data.second : nullptr; }
+				inline static void _write_chunk(std::ostream& os, uint32_t records, const std::string& bytes){
+					_write(os, records);
+					_write(os, (uint32_t)bytes.size());
+					_write(os, _checksum(bytes));
+					os.write(bytes.data(), bytes.size());
+				}
+				/*
+					delta : ranges of keys, each of which is followed by all the elements in the range
+				*/
+				inline static const uint32_t delta_version = 1;
+				enum : char { delta_end = 0, delta_range = 1, delta_lower = 2, delta_upper = 4 };
+				// leftmost node of the subtree if R is false, or else rightmost one
+				template<bool R> inline static const node* _edge(const node* n){
+					while(R ? n->r : n->l){
+						n = (R ? n->r : n->l).get();
+					}
+					return n;
+				}
+				inline static void _write_range(std::ostream& os, const node* lower, const node* upper, const std::vector<const node*>& run){
+					std::string bytes;
+					if(lower){
+						stream_codec<K>::encode(bytes, *_key_of(lower), nullptr);
+					}
+					if(upper){
+						stream_codec<K>::encode(bytes, *_key_of(upper), nullptr);
+					}
+					stream_codec_base::put_varint(bytes, run.size());
+					const node* prev = nullptr;
+					for(const node* n: run){
+						stream_codec<K>::encode(bytes, *_key_of(n), _key_of(prev));
+						if constexpr(with_value::value){
+							stream_codec<V>::encode(bytes, n->value(), _value_of(prev));
+						}
+						if constexpr(with_multiplicity::value){
+							stream_codec_base::put_varint(bytes, n->m);
+						}
+						prev = n;
+					}
+					os.put(delta_range | (lower ? delta_lower : 0) | (upper ? delta_upper : 0));
+					_write(os, (uint32_t)bytes.size());
+					_write(os, _checksum(bytes));
+					os.write(bytes.data(), bytes.size());
+				}
+				// removes the elements between lower and upper, both exclusive, where nullptr means no limit
+				inline void _erase_between(const K* lower, const K* upper){
+					while(true){
+						const node* n = lower ? this->template _find_nearest<tree_base0::_branch_gt, KR>(*lower) : (this->root ? _edge<false>(this->root.get()) : nullptr);
+						if(!n || (upper && _compare(n->key(), *upper) >= 0)){
+							break;
+						}
+						const K k = n->key();
+						_pop(tree_base0::template _make_branch_eq<KR>(k));
+					}
+				}
+				// applies the delta written by checkpoint_delta(). insert(node_uptr&&) links each element. the delta is read entirely before applying
+				template<typename F> bool _apply_delta(std::istream& is, F&& insert){
+					char magic[4];
+					uint32_t version, multiplicity;
+					if(!_read(is, magic) || std::string_view(magic, 4) != "AVLD" || !_read(is, version) || version != delta_version){
+						return false;
+					}
+					if(!_read(is, multiplicity) || multiplicity != with_multiplicity::value){
+						return false;
+					}
+					struct range{
+						std::unique_ptr<K> lower, upper;
+						std::vector<node_uptr> nodes;
+					};
+					std::vector<range> ranges;
+					while(true){
+						char flags;
+						if(!_read(is, flags)){
+							return false;
+						}
+						if(flags == delta_end){
+							break;
+						}
+						uint32_t size, checksum;
+						std::string bytes;
+						if(!(flags & delta_range) || !_read(is, size) || !_read(is, checksum)){
+							return false;
+						}
+						if(!_read_bytes(is, bytes, size) || _checksum(bytes) != checksum){
+							return false;
+						}
+						const char* p = bytes.data();
+						const char* e = p + size;
+						range r;
+						for(auto [bound, flag]: {std::make_pair(&r.lower, delta_lower), std::make_pair(&r.upper, delta_upper)}){
+							if(flags & flag){
+								K k;
+								if(!stream_codec<K>::decode(p, e, k, nullptr)){
+									return false;
+								}
+								*bound = std::make_unique<K>(std::move(k));
+							}
+						}
+						uint64_t n;
+						if(!stream_codec_base::get_varint(p, e, n)){
+							return false;
+						}
+						const node* prev = nullptr;
+						for(uint64_t i = 0; i < n; i ++){
+							K k;
+							if(!stream_codec<K>::decode(p, e, k, _key_of(prev))){
+								return false;
+							}
+							node_uptr cur;
+							if constexpr(with_value::value){
+								V v;
+								if(!stream_codec<V>::decode(p, e, v, _value_of(prev))){
+									return false;
+								}
+								cur = std::make_unique<node>(std::move(k), std::move(v));
+							}else{
+								cur = std::make_unique<node>(std::move(k));
+							}
+							if constexpr(with_multiplicity::value){
+								uint64_t m;
+								if(!stream_codec_base::get_varint(p, e, m) || m == 0){
+									return false;
+								}
+								cur->m = m;
+							}
+							prev = cur.get();
+							r.nodes.push_back(std::move(cur));
+						}
+						if(p != e){
+							return false;
+						}
+						ranges.push_back(std::move(r));
+					}
+					for(auto& r: ranges){
+						_erase_between(r.lower.get(), r.upper.get());
+						for(auto& n: r.nodes){
+							insert(std::move(n));
+						}
+					}
+					return true;
+				}
+				// replaces the contents with the stream. the previous record is kept by value, as the nodes are freed when a record fails
+				bool _import_stream(std::istream& is, bool allow_equal){
+					_clear();
+					char magic[4];
+					uint32_t version, multiplicity;
+					uint64_t n;
+					if(!_read(is, magic) || std::string_view(magic, 4) != "AVLS" || !_read(is, version) || version != stream_version){
+						return false;
+					}
+					if(!_read(is, multiplicity) || multiplicity != with_multiplicity::value || !_read(is, n)){
+						return false;
+					}
+					std::string chunk;
+					const char* p = nullptr;
+					const char* e = nullptr;
+					uint32_t rest = 0;
+					K prev_key{};
+					// avltree_base::empty of set and multiset is not default constructible since C++20
+					std::optional<V> prev_value;
+					bool has_prev = false;
+					return _assign_checked(n, allow_equal, [&]() -> node_uptr {
+						if(rest == 0){
+							uint32_t size, checksum;
+							if(!_read(is, rest) || !_read(is, size) || !_read(is, checksum) || rest == 0 || rest > stream_chunk_size){
+								return nullptr;
+							}
+							if(!_read_bytes(is, chunk, size) || _checksum(chunk) != checksum){
+								return nullptr;
+							}
+							p = chunk.data();
+							e = p + size;
+							has_prev = false;
+						}
+						K k;
+						if(!stream_codec<K>::decode(p, e, k, has_prev ? &prev_key : nullptr)){
+							return nullptr;
+						}
+						node_uptr cur;
+						if constexpr(with_value::value){
+							V v;
+							if(!stream_codec<V>::decode(p, e, v, has_prev ? &*prev_value : nullptr)){
+								return nullptr;
+							}
+							cur = std::make_unique<node>(std::move(k), std::move(v));
+						}else{
+							cur = std::make_unique<node>(std::move(k));
+						}
+						if constexpr(with_multiplicity::value){
+							uint64_t m;
+							if(!stream_codec_base::get_varint(p, e, m) || m == 0){
+								return nullptr;
+							}
+							cur->m = m;
+						}
+						rest --;
+						if(rest == 0 && p != e){
+							return nullptr;
+						}
+						prev_key = *_key_of(cur.get());
+						if constexpr(with_value::value){
+							prev_value = cur->value();
+						}
+						has_prev = true;
+						return cur;
+					});
+				}
+				node_uptr _pop(branch_func branch){
+					[[maybe_unused]] const auto scope = this->_measure(&operation_stats::remove);
+					auto [node, height] = this->_find(branch);
+					return _remove(node, height);
+				}
+				// pops the leftmost node if R is false, or else the rightmost one. the path is followed without comparisons
+				template<bool R> node_uptr _pop_edge(){
+					[[maybe_unused]] const auto scope = this->_measure(&operation_stats::remove);
+					node_uptr* cur = &this->root;
+					size_t height = 0;
+					for(; *cur && (R ? (*cur)->r : (*cur)->l); height ++){
+						this->stack[height] = cur;
+						cur = &(R ? (*cur)->r : (*cur)->l);
+					}
+					this->_count_search(height + (*cur ? 1 : 0), _comparisons);
+					return _remove(*cur, height);
+				}
+				// removes the node at the slot, whose ancestors are on the stack
+				node_uptr _remove(node_uptr& node, size_t height){
+					node_uptr* cur = &node;
+					node_uptr release = nullptr;
+					if(*cur){
+						node_uptr& n = *cur;
+						if constexpr(with_multiplicity::value){
+							if(n->m > 1){
+								n->m --;
+								_update_path(*n, height, -1);
+								return this->_new_node(n->key());
+							}
+						}
+						if(n->l){
+							if(n->r){
+								auto get_f = n->balance() >= 0 ? get_l : get_r;
+								auto get_b = n->balance() >= 0 ? get_r : get_l;
+								const size_t top = height;
+								this->stack[height] = cur;
+								height ++;
+								cur = &get_f(**cur);
+								while(get_b(**cur)){
+									this->stack[height] = cur;
+									height ++;
+									cur = &get_b(**cur);
+								}
+								// the neighbor is relinked in place of n instead of moving the elements, so every element stays in its node
+								node_uptr neighbor = std::move(*cur);
+								*cur = std::move(get_f(*neighbor));
+								if(height > top + 1){
+									this->stack[top + 1] = &get_f(*neighbor);
+								}else{
+									cur = &get_f(*neighbor);
+								}
+								_take_place(*neighbor, *n);
+								release = std::move(n);
+								n = std::move(neighbor);
+							}else{
+								std::swap(release, n->l);
+								std::swap(n, release);
+							}
+						}else{
+							std::swap(release, n->r);
+							std::swap(n, release);
+						}
+						_unlink_extremes(release.get(), cur->get(), height);
+						if constexpr(with_hash_index::value){
+							this->_hash_erase(release.get());
+						}
+						if(height > 0){
+							_fix_balance<-1>(*cur, height);
+						}else{
+							_mark_path(cur->get(), 0);
+							if constexpr(!with_index::value){
+								this->_count --;
+							}
+						}
+						if constexpr(with_stats::value){
+							this->_stats.releases ++;
+						}
+					}
+					return release;
+				}
+				
+				/*
+					weak AVL rebalancing for tree_spec::with_wavl: at most 2 rotations per update, and O(1) amortized rank changes
+				*/
+				inline static int _rank(const node_uptr& n){ return n ? n->rank : -1; }
+				// refreshes the cached values of n from its children
+				inline void _refresh(node& n){
+					_mark(n);
+					if constexpr(with_depth::value){
+						n.reset_depth();
+					}
+					if constexpr(with_index::value){
+						n.update_count();
+					}
+					if constexpr(with_summary::value){
+						n.update_summary();
+					}
+				}
+				// lifts L(*p), the child on the side L, to the place of p
+				template<node_uptr& L(node&), node_uptr& R(node&)> inline void _lift(node_uptr& p){
+					node_uptr c = std::move(L(*p));
+					L(*p) = std::move(R(*c));
+					R(*c) = std::move(p);
+					p = std::move(c);
+					_refresh(*R(*p));
+					_refresh(*p);
+				}
+				// after an insertion, the child x on the side L has the same rank as p, and the other child has the rank difference 2
+				template<node_uptr& L(node&), node_uptr& R(node&)> inline void _rotate_inserted(node_uptr& p){
+					node& x = *L(*p);
+					const node_uptr& y = R(x);
+					p->rank --;
+					if(!y || x.rank - y->rank == 2){
+						if constexpr(with_stats::value){
+							this->_stats.single_rotations ++;
+						}
+						_lift<L, R>(p);
+					}else{
+						if constexpr(with_stats::value){
+							this->_stats.double_rotations ++;
+						}
+						y->rank ++;
+						x.rank --;
+						_lift<R, L>(L(*p));
+						_lift<L, R>(p);
+					}
+				}
+				// after a removal, the child x on the side R has the rank difference 3, and the sibling s on the side L has 1 and is not a 2,2 node
+				template<node_uptr& L(node&), node_uptr& R(node&)> inline void _rotate_removed(node_uptr& p){
+					node& s = *L(*p);
+					if(s.rank - _rank(L(s)) == 1){
+						if constexpr(with_stats::value){
+							this->_stats.single_rotations ++;
+						}
+						s.rank ++;
+						_lift<L, R>(p);
+						// the former p is demoted once, or twice if it became a leaf
+						node& z = *R(*p);
+						z.rank -= z.l || z.r ? 1 : 2;
+					}else{
+						if constexpr(with_stats::value){
+							this->_stats.double_rotations ++;
+						}
+						node& u = *R(s);
+						u.rank += 2;
+						s.rank --;
+						p->rank -= 2;
+						_lift<R, L>(L(*p));
+						_lift<L, R>(p);
+					}
+				}
+				// fixes the ranks at p, whose child at *x changed its rank. returns whether the ancestors have to be checked as well
+				template<int D> inline bool _fix_rank_at(node_uptr& p, const node_uptr* x){
+					const bool left = &p->l == x;
+					const node_uptr& s = left ? p->r : p->l;
+					if constexpr(D == 1){
+						if(_rank(*x) != p->rank){
+							return false;
+						}
+						if(p->rank - _rank(s) == 1){
+							p->rank ++;
+							return true;
+						}
+						if(left){
+							_rotate_inserted<get_l, get_r>(p);
+						}else{
+							_rotate_inserted<get_r, get_l>(p);
+						}
+						return false;
+					}else{
+						if(!p->l && !p->r){
+							// a leaf must have rank 0
+							if(p->rank == 0){
+								return false;
+							}
+							p->rank = 0;
+							return true;
+						}
+						if(p->rank - _rank(*x) != 3){
+							return false;
+						}
+						if(p->rank - _rank(s) == 2){
+							p->rank --;
+							return true;
+						}
+						if(s->rank - _rank(s->l) == 2 && s->rank - _rank(s->r) == 2){
+							s->rank --;
+							p->rank --;
+							return true;
+						}
+						if(left){
+							_rotate_removed<get_r, get_l>(p);
+						}else{
+							_rotate_removed<get_l, get_r>(p);
+						}
+						return false;
+					}
+				}
+				template<int D> inline void _fix_rank(node_uptr& cur, size_t height){
+					const node_uptr* child = &cur;
+					_mark_path(cur.get(), height);
+					if constexpr(!with_index::value){
+						this->_count += D;
+					}
+					bool fixing = true;
+					while(height > 0){
+						height --;
+						node_uptr* parent_ptr = this->stack[height];
+						node& parent = **parent_ptr;
+						if constexpr(with_index::value){
+							if constexpr(with_multiplicity::value || with_tombstone::value){
+								parent.update_count();
+							}else{
+								parent.c += D;
+							}
+						}
+						if constexpr(with_depth::value){
+							parent.reset_depth();
+						}
+						if constexpr(with_summary::value){
+							parent.update_summary();
+						}
+						if(fixing){
+							if constexpr(with_stats::value){
+								this->_stats.rebalance_steps ++;
+							}
+							fixing = _fix_rank_at<D>(*parent_ptr, child);
+						}else if constexpr(!(with_depth::value || with_index::value || with_summary::value)){
+							break;
+						}
+						child = parent_ptr;
+					}
+					// every node is at depth of the rank of the root at most
+					if(this->root && this->stack.size() <= (size_t)this->root->rank){
+						this->stack.resize(this->root->rank + 1, nullptr);
+					}
+				}
+				template<int D> inline void _fix_avl(node_uptr& cur, size_t height){
+					node_uptr* child = &cur;
+					_mark_path(cur.get(), height);
+					if constexpr(!with_index::value){
+						this->_count += D;
+					}
+					const auto max_depth = height;
+					while(height > 0){
+						height --;
+						if constexpr(with_stats::value){
+							this->_stats.rebalance_steps ++;
+						}
+						node_uptr* parent_ptr = this->stack[height];
+						node& parent = **parent_ptr;
+						if constexpr(with_index::value){
+							if constexpr(with_multiplicity::value || with_tombstone::value){
+								parent.update_count();
+							}else{
+								parent.c += D;
+							}
+						}
+						if constexpr(with_summary::value){
+							parent.update_summary();
+						}
+						if constexpr(with_depth::value){
+							parent.reset_depth();
+						}else{
+							if(&parent.l == child){
+								parent.b += D;
+							}else{
+								parent.b -= D;
+							}
+						}
+						if(parent.balance() == 2){
+							_rotate_lr(*parent_ptr);
+							if constexpr(D == 1){
+								break;
+							}else{
+								if((*parent_ptr)->balance() != 0){
+									break;
+								}
+							}
+						}else if(parent.balance() == -2){
+							_rotate_rl(*parent_ptr);
+							if constexpr(D == 1){
+								break;
+							}else{
+								if((*parent_ptr)->balance() != 0){
+									break;
+								}
+							}
+						}else if(parent.balance() == 0){
+							if constexpr(D == 1){
+								break;
+							}
+						}else{
+							if constexpr(D != 1){
+								break;
+							}
+						}
+						child = parent_ptr;
+					}
+					if(height == 0){
+						if constexpr(D == 1){
+							if(this->stack.size() <= max_depth){
+								this->stack.push_back(nullptr);
+							}
+						}
+					}else{
+						if constexpr(with_depth::value || with_index::value || with_summary::value){
+							while(height > 0){
+								height --;
+								node_uptr* parent_ptr = this->stack[height];
+								node& parent = **parent_ptr;
+								if constexpr(with_index::value){
+									if constexpr(with_multiplicity::value || with_tombstone::value){
+										parent.update_count();
+									}else{
+										parent.c += D;
+									}
+								}
+								if constexpr(with_depth::value){
+									parent.reset_depth();
+								}
+								if constexpr(with_summary::value){
+									parent.update_summary();
+								}
+								child = parent_ptr;
+							}
+						}
+					}
+				}
+				
+				/*
+					extremes for tree_spec::with_extremes
+				*/
+				// n was linked as a leaf below the top of the stack
+				inline void _link_extremes(const node* n, size_t height){
+					if constexpr(with_extremes::value){
+						if(height == 0){
+							this->_first = this->_last = n;
+							return;
+						}
+						const node* parent = this->stack[height - 1]->get();
+						if(parent == this->_first && parent->l.get() == n){
+							this->_first = n;
+						}
+						if(parent == this->_last && parent->r.get() == n){
+							this->_last = n;
+						}
+					}
+				}
+				// n was unlinked and replaced with the subtree at next, before rebalancing. the neighbor of n is the edge of next, or else the parent
+				inline void _unlink_extremes(const node* n, const node* next, size_t height){
+					if constexpr(with_extremes::value){
+						const node* parent = height > 0 ? this->stack[height - 1]->get() : nullptr;
+						if(n == this->_first){
+							this->_first = next ? _edge<false>(next) : parent;
+						}
+						if(n == this->_last){
+							this->_last = next ? _edge<true>(next) : parent;
+						}
+					}
+				}
+				inline void _reset_extremes(){
+					if constexpr(with_extremes::value){
+						this->_find_extremes();
+					}
+				}
+				
+				// fixes the balance and the cached values of the ancestors on the stack, after the subtree at cur grew (D = 1) or shrank (D = -1) by a node
+				template<int D> inline void _fix_balance(node_uptr& cur, size_t height){
+					if constexpr(D == 1){
+						_link_extremes(cur.get(), height);
+						if constexpr(with_hash_index::value){
+							this->_hash_insert(cur.get());
+						}
+					}
+					if constexpr(with_wavl::value){
+						_fix_rank<D>(cur, height);
+					}else{
+						_fix_avl<D>(cur, height);
+					}
+				}
+				
+				/*
+					splitting and joining subtrees in O(log N), for range erasure
+				*/
+				// height of the subtree (0 if empty). for with_wavl, the rank + 1 is used instead
+				inline static int _height(const node* n){
+					if constexpr(with_wavl::value){
+						return n ? n->rank + 1 : 0;
+					}else if constexpr(with_depth::value){
+						return n ? n->h : 0;
+					}else{
+						int h = 0;
+						for(; n; h ++){
+							n = n->b < 0 ? n->r.get() : n->l.get();
+						}
+						return h;
+					}
+				}
+				// heights of the children of n, whose height is h
+				inline static int _height_l(const node& n, int h){
+					if constexpr(with_wavl::value || with_depth::value){
+						return _height(n.l.get());
+					}else{
+						return n.b >= 0 ? h - 1 : h - 2;
+					}
+				}
+				inline static int _height_r(const node& n, int h){
+					if constexpr(with_wavl::value || with_depth::value){
+						return _height(n.r.get());
+					}else{
+						return n.b <= 0 ? h - 1 : h - 2;
+					}
+				}
+				inline static size_t _count_elements(const node* n){
+					if constexpr(with_index::value){
+						return n ? n->c : 0;
+					}else{
+						return n ? _count_elements(n->l.get()) + _count_elements(n->r.get()) + n->weight() : 0;
+					}
+				}
+				// links l and r under m, whose heights differ by 1 at most
+				inline node_uptr _join_node(node_uptr l, int hl, node_uptr m, node_uptr r, int hr, int& h){
+					m->l = std::move(l);
+					m->r = std::move(r);
+					if constexpr(with_wavl::value){
+						m->rank = std::max(hl, hr);
+					}else if constexpr(!with_depth::value){
+						m->b = hl - hr;
+					}
+					_refresh(*m);
+					h = std::max(hl, hr) + 1;
+					return m;
+				}
+				// joins m and o into the taller tree t, going down along the side R of t (D = 1 for the right side) to the subtree as tall as o
+				template<node_uptr& R(node&), int D> node_uptr _join_down(node_uptr t, int ht, node_uptr m, node_uptr o, int ho, int& h){
+					const int hs = D == 1 ? _height_l(*t, ht) : _height_r(*t, ht);
+					const int hc = D == 1 ? _height_r(*t, ht) : _height_l(*t, ht);
+					node_uptr& c = R(*t);
+					int hn;
+					if(hc <= ho + 1){
+						c = D == 1 ? _join_node(std::move(c), hc, std::move(m), std::move(o), ho, hn) : _join_node(std::move(o), ho, std::move(m), std::move(c), hc, hn);
+					}else{
+						c = _join_down<R, D>(std::move(c), hc, std::move(m), std::move(o), ho, hn);
+					}
+					// c grew by 1 at most, which is fixed in the same way as insertions
+					if constexpr(with_wavl::value){
+						_refresh(*t);
+						_fix_rank_at<1>(t, &R(*t));
+						h = t->rank + 1;
+					}else{
+						if constexpr(!with_depth::value){
+							t->b = D * (hs - hn);
+						}
+						_refresh(*t);
+						if(hn - hs == 2){
+							const int cb = R(*t)->balance();
+							if constexpr(D == 1){
+								_rotate_rl(t);
+							}else{
+								_rotate_lr(t);
+							}
+							h = hs + (cb == 0 ? 3 : 2);
+						}else{
+							h = std::max(hs, hn) + 1;
+						}
+					}
+					return t;
+				}
+				// joins l, m and r, where the keys in l precede m and those in r follow m
+				inline node_uptr _join(node_uptr l, int hl, node_uptr m, node_uptr r, int hr, int& h){
+					if(hl > hr + 1){
+						return _join_down<get_r, 1>(std::move(l), hl, std::move(m), std::move(r), hr, h);
+					}else if(hr > hl + 1){
+						return _join_down<get_l, -1>(std::move(r), hr, std::move(m), std::move(l), hl, h);
+					}
+					return _join_node(std::move(l), hl, std::move(m), std::move(r), hr, h);
+				}
+				// detaches the first node of t into m
+				node_uptr _split_first(node_uptr t, int ht, node_uptr& m, int& h){
+					const int hl = _height_l(*t, ht), hr = _height_r(*t, ht);
+					node_uptr l = std::move(t->l);
+					node_uptr r = std::move(t->r);
+					if(!l){
+						m = std::move(t);
+						h = hr;
+						return r;
+					}
+					int hl2;
+					l = _split_first(std::move(l), hl, m, hl2);
+					return _join(std::move(l), hl2, std::move(t), std::move(r), hr, h);
+				}
+				// joins l and r, where the keys in l precede those in r
+				inline node_uptr _join2(node_uptr l, int hl, node_uptr r, int hr, int& h){
+					if(!l || !r){
+						h = l ? hl : hr;
+						return l ? std::move(l) : std::move(r);
+					}
+					node_uptr m;
+					int hr2;
+					r = _split_first(std::move(r), hr, m, hr2);
+					return _join(std::move(l), hl, std::move(m), std::move(r), hr2, h);
+				}
+				// splits t into l, the nodes n for which before(n, n.l) is true, and r, the others. before() is called from the root downward
+				template<typename F> void _split(node_uptr t, int ht, F& before, node_uptr& l, int& hl, node_uptr& r, int& hr){
+					if(!t){
+						hl = hr = 0;
+						return;
+					}
+					const int htl = _height_l(*t, ht), htr = _height_r(*t, ht);
+					node_uptr tl = std::move(t->l);
+					node_uptr tr = std::move(t->r);
+					if(before(*t, tl)){
+						node_uptr rl;
+						int hrl;
+						_split(std::move(tr), htr, before, rl, hrl, r, hr);
+						l = _join(std::move(tl), htl, std::move(t), std::move(rl), hrl, hl);
+					}else{
+						node_uptr lr;
+						int hlr;
+						_split(std::move(tl), htl, before, l, hl, lr, hlr);
+						r = _join(std::move(lr), hlr, std::move(t), std::move(tr), htr, hr);
+					}
+				}
+				// detaches the nodes between the two boundaries given by before_s() and before_e()
+				template<typename F1, typename F2> erased_range _erase_range(F1&& before_s, F2&& before_e){
+					[[maybe_unused]] const auto scope = this->_measure(&operation_stats::remove);
+					node_uptr a, b, m, c;
+					int ha, hb, hm, hc, h = _height(this->root.get());
+					_split(std::move(this->root), h, before_s, a, ha, b, hb);
+					_split(std::move(b), hb, before_e, m, hm, c, hc);
+					this->root = _join2(std::move(a), ha, std::move(c), hc, h);
+					_reset_extremes();
+					if constexpr(with_hash_index::value){
+						this->_hash_erase_subtree(m.get());
+					}
+					const size_t n = _count_elements(m.get());
+					if constexpr(!with_index::value){
+						this->_count -= n;
+					}
+					if constexpr(with_tombstone::value){
+						this->_dead -= _count_nodes(m.get()) - n;
+					}
+					if constexpr(with_stats::value){
+						this->_stats.releases += _count_nodes(m.get());
+					}
+					if(this->stack.size() <= (size_t)h){
+						this->stack.resize(h + 1, nullptr);
+					}
+					return erased_range(std::move(m), n);
+				}
+				
+				// links the sorted nodes batch[0, n) into t by splitting t at the middle one and recursing on both halves, in O(n log(N / n + 1)).
+				// a node of t whose key equals one in the batch stays in place, taking the value (for map) or adding the multiplicity (with tree_spec::with_multiplicity) of the new one
+				node_uptr _union(node_uptr t, int ht, node_uptr* batch, size_t n, int& h, size_t& replaced){
+					if(n == 0){
+						h = ht;
+						return t;
+					}
+					node_uptr m = std::move(batch[n / 2]);
+					auto before = [&m](const node& x, const node_uptr&){ return _compare(x.key(), m->key()) < 0; };
+					node_uptr l, r;
+					int hl, hr;
+					_split(std::move(t), ht, before, l, hl, r, hr);
+					if(r && _compare(_edge<false>(r.get())->key(), m->key()) == 0){
+						node_uptr old;
+						r = _split_first(std::move(r), hr, old, hr);
+						if constexpr(with_multiplicity::value){
+							old->m += m->m;
+							if constexpr(!with_index::value){
+								this->_count += m->m;
+							}
+						}else if constexpr(with_value::value){
+							old->value() = std::move(m->value());
+						}
+						if constexpr(with_tombstone::value){
+							// a dead node is revived, which counts as a new key
+							if(old->dead){
+								old->dead = false;
+								this->_dead --;
+							}else{
+								replaced ++;
+							}
+						}else{
+							replaced ++;
+						}
+						m = std::move(old);
+					}else{
+						if constexpr(with_hash_index::value){
+							this->_hash_insert(m.get());
+						}
+						if constexpr(!with_index::value){
+							this->_count += m->weight();
+						}
+					}
+					l = _union(std::move(l), hl, batch, n / 2, hl, replaced);
+					r = _union(std::move(r), hr, batch + n / 2 + 1, n - n / 2 - 1, hr, replaced);
+					return _join(std::move(l), hl, std::move(m), std::move(r), hr, h);
+				}
+				// for unique keys: inserts the elements in [first, last), where the last one of equal keys remains, and returns the number of the keys not contained before
+				template<typename I> size_t _insert_batch(I first, I last){
+					[[maybe_unused]] const auto scope = this->_measure(&operation_stats::insert);
+					std::vector<node_uptr> batch;
+					for(; first != last; ++ first){
+						batch.push_back(this->_new_node(*first));
+					}
+					const auto less = [](const node_uptr& a, const node_uptr& b){ return _compare(a->key(), b->key()) < 0; };
+					if(!std::is_sorted(batch.begin(), batch.end(), less)){
+						std::stable_sort(batch.begin(), batch.end(), less);
+					}
+					size_t n = 0;
+					for(size_t i = 0; i < batch.size(); i ++){
+						if(n > 0 && !less(batch[n - 1], batch[i])){
+							batch[n - 1] = std::move(batch[i]);
+						}else{
+							batch[n ++] = std::move(batch[i]);
+						}
+					}
+					// a batch much smaller than the tree is inserted one by one in order, each descending from the root, which is cheaper than merging with the whole tree
+					if(n * 8 < this->size()){
+						size_t added = 0;
+						for(size_t i = 0; i < n; i ++){
+							added += _insert_node(std::move(batch[i]));
+						}
+						return added;
+					}
+					size_t replaced = 0;
+					int h = _height(this->root.get());
+					this->root = _union(std::move(this->root), h, batch.data(), n, h, replaced);
+					_reset_extremes();
+					if(this->stack.size() <= (size_t)h){
+						this->stack.resize(h + 1, nullptr);
+					}
+					return n - replaced;
+				}
+				
+				tree_base2() : tree_base1t(){};
+			public:
+				// with tree_spec::with_tombstone, the node is only marked dead, and whether k was contained is returned instead of the node
+				template<typename Q = K> auto remove(const Q& k){
+					if constexpr(with_tombstone::value){
+						return _bury(tree_base0::template _make_branch_eq<QR<Q>>(k));
+					}else{
+						return node_uptr_view(_pop(tree_base0::template _make_branch_eq<QR<Q>>(k)));
+					}
+				}
+				// rebuilds the tree from the alive nodes in O(N), and frees the dead ones
+				void compact(){
+					static_assert(with_tombstone::value, "compact() is available only with tree_spec::with_tombstone");
+					std::vector<node_uptr> nodes;
+					nodes.reserve(this->size());
+					if constexpr(with_stats::value){
+						this->_stats.releases += this->_dead;
+					}
+					_collect_alive(std::move(this->root), nodes);
+					this->_dead = 0;
+					size_t i = 0;
+					_assign_sorted(nodes.size(), [&nodes, &i]{ return std::move(nodes[i ++]); });
+				}
+				// detaches the elements not less than k_s and less than k_e in O(log N), which are destroyed with the returned object
+				template<typename Q = K> erased_range erase_range(const Q& k_s, const Q& k_e){
+					const query<QR<Q>> q_s(k_s), q_e(k_e);
+					return _erase_range([&q_s](const node& n, const node_uptr&){ return _compare(q_s, n) > 0; }, [&q_e](const node& n, const node_uptr&){ return _compare(q_e, n) > 0; });
+				}
+				// detaches the elements from the index i_s to i_e - 1 in O(log N), which are destroyed with the returned object
+				erased_range erase_index_range(size_t i_s, size_t i_e){
+					static_assert(with_index::value, "erase_index_range() is available only with tree_spec::with_index");
+					static_assert(!with_multiplicity::value, "erase_index_range() is not available with tree_spec::with_multiplicity");
+					i_e = std::min(i_e, this->size());
+					i_s = std::min(i_s, i_e);
+					const auto before = [](size_t& rest){
+						return [&rest](const node& n, const node_uptr& l){
+							const size_t c = (l ? l->c : 0) + n.weight();
+							if(c <= rest){
+								rest -= c;
+								return true;
+							}
+							return false;
+						};
+					};
+					size_t rest_s = i_s, rest_e = i_e - i_s;
+					return _erase_range(before(rest_s), before(rest_e));
+				}
+				node_uptr_view pop_first(){
+					if constexpr(with_tombstone::value){
+						return pop_at(0);
+					}else{
+						return node_uptr_view(_pop_edge<false>());
+					}
+				}
+				node_uptr_view pop_last(){
+					if constexpr(with_tombstone::value){
+						return pop_at(this->size() - 1);
+					}else{
+						return node_uptr_view(_pop_edge<true>());
+					}
+				}
+				// the first and the last elements, in O(1) with tree_spec::with_extremes or else O(log N)
+				inline const node_view peek_min() const{
+					if constexpr(with_extremes::value){
+						return node_view(this->_first);
+					}else if constexpr(with_tombstone::value){
+						return this->at(0);
+					}else{
+						return node_view(this->root ? _edge<false>(this->root.get()) : nullptr);
+					}
+				}
+				inline const node_view peek_max() const{
+					if constexpr(with_extremes::value){
+						return node_view(this->_last);
+					}else if constexpr(with_tombstone::value){
+						return this->at(this->size() - 1);
+					}else{
+						return node_view(this->root ? _edge<true>(this->root.get()) : nullptr);
+					}
+				}
+				
+				template<typename Q = K> bool contains(const Q& k) const{
+					[[maybe_unused]] const auto scope = this->_measure(&operation_stats::find);
+					if constexpr(with_hash_index::value && std::is_same_v<Q, K>){
+						return this->_hash_find(k) != nullptr;
+					}
+					const node* n = this->_find(tree_base0::template _make_branch_eq<QR<Q>>(k));
+					return n && !_is_dead(*n);
+				}
+				
+				void print(){
+					if(this->root){
+						this->root->print();
+					}
+				}
+				
+				memory_usage_report memory_usage() const{
+					memory_usage_report report{};
+					report.nodes = _count_nodes(this->root.get());
+					report.node_bytes = report.nodes * sizeof(node);
+					report.payload_bytes = report.nodes * sizeof(data_type);
+					if constexpr(with_summary::value){
+						report.summary_bytes = report.nodes * sizeof(typename summarizer::type);
+					}
+					report.link_bytes = report.node_bytes - report.payload_bytes - report.summary_bytes;
+					report.scratch_bytes = this->stack.capacity() * sizeof(node_uptr*);
+					report.total_bytes = sizeof(*this) + report.node_bytes + report.scratch_bytes;
+					return report;
+				}
+				// statistics of the shape, by visiting every node once
+				tree_stats stats() const{
+					tree_stats st{};
+					size_t path_length = 0;
+					std::function<void(const node*, size_t)> visit = [&](const node* n, size_t depth){
+						if(!n){
+							return;
+						}
+						if(st.depth_histogram.size() <= depth){
+							st.depth_histogram.resize(depth + 1, 0);
+						}
+						st.depth_histogram[depth] ++;
+						st.nodes ++;
+						path_length += depth + 1;
+						// heights of the children in a WAVL tree may differ more, but their ranks do not
+						if constexpr(with_wavl::value){
+							st.balance_histogram[(n->l ? n->l->rank : -1) - (n->r ? n->r->rank : -1) + 1] ++;
+						}else{
+							st.balance_histogram[n->balance() + 1] ++;
+						}
+						visit(n->l.get(), depth + 1);
+						visit(n->r.get(), depth + 1);
+					};
+					visit(this->root.get(), 0);
+					st.height = st.depth_histogram.size();
+					if(st.nodes > 0){
+						st.average_path_length = (double)path_length / st.nodes;
+						// a perfectly balanced tree has 2^d nodes at each depth d except the last
+						size_t rest = st.nodes, optimal_length = 0;
+						for(size_t d = 0; rest > 0; d ++){
+							const size_t at_depth = std::min(rest, (size_t)1 << std::min<size_t>(d, 63));
+							optimal_length += at_depth * (d + 1);
+							rest -= at_depth;
+							st.optimal_height = d + 1;
+						}
+						st.optimal_average_path_length = (double)optimal_length / st.nodes;
+					}
+					return st;
+				}
+				
+				// moves the elements to new nodes allocated in the order of traversal, so that the nodes are adjacent in memory after churn:
+				// the top levels in breadth first order, and then each subtree below them in order. node_view, iterators and the other references to the nodes are invalidated
+				void relayout(size_t levels = 6){
+					size_t step = 0;
+					do{
+						step = relayout_step(step, levels);
+					}while(step != 0);
+				}
+				// does a part of relayout(levels) to bound the pause: step 0 moves the top levels, and step i > 0 moves the i-th of the 2^levels subtrees below them.
+				// returns the next step, or 0 after the last one. the tree can be updated between the steps
+				size_t relayout_step(size_t step, size_t levels = 6){
+					levels = std::clamp<size_t>(levels, 1, 20);
+					std::vector<node*> order;
+					std::vector<size_t> depth;
+					if(step == 0){
+						if(this->root){
+							order.push_back(this->root.get());
+							depth.push_back(0);
+						}
+						for(size_t i = 0; i < order.size(); i ++){
+							if(depth[i] + 1 < levels){
+								for(node* c: {order[i]->l.get(), order[i]->r.get()}){
+									if(c){
+										order.push_back(c);
+										depth.push_back(depth[i] + 1);
+									}
+								}
+							}
+						}
+						if(!order.empty()){
+							_relayout(this->root, order, depth, levels);
+						}
+					}else{
+						// the bits of step - 1 tell the path from the root to the subtree, from the most significant one
+						node_uptr* top = &this->root;
+						for(size_t d = 0; d < levels && *top; d ++){
+							top = ((step - 1) >> (levels - 1 - d)) & 1 ? &(*top)->r : &(*top)->l;
+						}
+						std::function<void(node*)> visit = [&](node* n){
+							if(n){
+								visit(n->l.get());
+								order.push_back(n);
+								visit(n->r.get());
+							}
+						};
+						visit(top->get());
+						depth.assign(order.size(), 0);
+						if(!order.empty()){
+							_relayout(*top, order, depth, SIZE_MAX);
+						}
+					}
+					return step < ((size_t)1 << levels) ? step + 1 : 0;
+				}
+				
+				template<typename Q = K> inline const node_view find(const Q& k) const{
+					[[maybe_unused]] const auto scope = this->_measure(&operation_stats::find);
+					if constexpr(with_hash_index::value && std::is_same_v<Q, K>){
+						return node_view(this->_hash_find(k));
+					}
+					const node* n = this->_find(tree_base0::template _make_branch_eq<QR<Q>>(k));
+					return node_view(n && !_is_dead(*n) ? n : nullptr);
+				}
+				template<typename Q = K> inline const iterator iterator_find(const Q& k) const{ return iterator(this->stack.size(), this->root.get(), tree_base0::template _make_branch_eq<QR<Q>>(k)); }
+				// the iterator of the first element not less than k. the path goes left at the nodes of the same key before it
+				template<typename Q = K> inline const iterator iterator_ge(const Q& k) const{
+					const node_view first = _nearest<tree_base0::_branch_first_ge, QR<Q>>(k);
+					if(!first){
+						return iterator(this->stack.size(), nullptr);
+					}
+					const data_type* target = &*first;
+					const K* target_key;
+					if constexpr(with_value::value){
+						target_key = &target->first;
+					}else{
+						target_key = target;
+					}
+					return iterator(this->stack.size(), this->root.get(), [target, target_key](const node& cur){
+						return &cur.data == target ? 0 : (_compare(cur.key(), *target_key) < 0 ? 1 : -1);
+					});
+				}
+				
+				template<typename Q = K> inline const node_view find_ge(const Q& k) const{ return _nearest<tree_base0::_branch_ge, QR<Q>>(k); }
+				template<typename Q = K> inline const node_view find_gt(const Q& k) const{ return _nearest<tree_base0::_branch_gt, QR<Q>>(k); }
+				template<typename Q = K> inline const node_view find_le(const Q& k) const{ return _nearest<tree_base0::_branch_le, QR<Q>>(k); }
+				template<typename Q = K> inline const node_view find_lt(const Q& k) const{ return _nearest<tree_base0::_branch_lt, QR<Q>>(k); }
+				
+				// the nearest node, with tree_spec::with_tombstone the nearest alive one
+				template<int B(const node&, const node*&, int), typename KA> inline const node_view _nearest(KA k) const{
+					if constexpr(with_tombstone::value){
+						return std::get<0>(this->template _find_nearest_with_index<B, KA>(k));
+					}else{
+						return node_view(this->template _find_nearest<B, KA>(k));
+					}
+				}
+				
+				inline iterator begin() const{ return iterator(this->stack.size(), this->root.get()); }
+				inline iterator last() const{ return iterator(this->stack.size(), this->root.get(), false); }
+				inline reverse_iterator rbegin() const{ return reverse_iterator(this->stack.size(), this->root.get()); }
+				inline reverse_iterator rlast() const{ return reverse_iterator(this->stack.size(), this->root.get(), false); }
+				inline std::nullptr_t end() const{ return nullptr; }
+				inline std::nullptr_t rend() const{ return end(); }
+				
+				inline node_uptr_view pop_at(size_t index){
+					static_assert(with_index::value, "pop_at() is available only with tree_spec::with_index");
+					return node_uptr_view(_pop(tree_base0::_make_branch_at(index)));
+				}
+				
+				// writes the elements in order, in chunks compressed by avltree::stream_codec
+				void export_stream(std::ostream& os) const{
+					os.write("AVLS", 4);
+					_write(os, stream_version);
+					_write(os, (uint32_t)with_multiplicity::value);
+					_write(os, (uint64_t)(with_tombstone::value ? this->size() : _count_nodes(this->root.get())));
+					std::string chunk;
+					uint32_t records = 0;
+					const node* prev = nullptr;
+					_for_each_node(this->root.get(), [&](const node& n){
+						if(_is_dead(n)){
+							return;
+						}
+						stream_codec<K>::encode(chunk, n.key(), _key_of(prev));
+						if constexpr(with_value::value){
+							stream_codec<V>::encode(chunk, n.value(), _value_of(prev));
+						}
+						if constexpr(with_multiplicity::value){
+							stream_codec_base::put_varint(chunk, n.m);
+						}
+						prev = &n;
+						if(++ records == stream_chunk_size){
+							_write_chunk(os, records, chunk);
+							chunk.clear();
+							records = 0;
+							prev = nullptr;
+						}
+					});
+					if(records > 0){
+						_write_chunk(os, records, chunk);
+					}
+				}
+				
+				// writes the ranges of keys changed after the last call, with their current elements, and starts a new generation
+				void checkpoint_delta(std::ostream& os){
+					static_assert(with_generation::value, "checkpoint_delta() is available only with tree_spec::with_generation");
+					os.write("AVLD", 4);
+					_write(os, delta_version);
+					_write(os, (uint32_t)with_multiplicity::value);
+					const node* last_clean = nullptr;
+					std::vector<const node*> run;
+					bool in_run = false;
+					const auto close_run = [&](const node* upper){
+						_write_range(os, last_clean, upper, run);
+						run.clear();
+						in_run = false;
+					};
+					std::function<void(const node*)> visit = [&](const node* n){
+						if(!n){
+							return;
+						}
+						if(n->g != this->_generation){
+							if(in_run){
+								close_run(_edge<false>(n));
+							}
+							last_clean = _edge<true>(n);
+							return;
+						}
+						visit(n->l.get());
+						in_run = true;
+						run.push_back(n);
+						visit(n->r.get());
+					};
+					visit(this->root.get());
+					if(in_run || !this->root){
+						close_run(nullptr);
+					}
+					os.put(0);
+					this->_generation ++;
+				}
+				
+				// writes the tree as a flat image, which image_view reads in place
+				void save_image(std::ostream& os) const{
+					static_assert(is_flat<data_type>::value, "save_image() is available only for trivially copyable keys and values");
+					if constexpr(with_summary::value){
+						static_assert(is_flat<typename summarizer::type>::value, "save_image() is available only for trivially copyable summaries");
+					}
+					std::vector<const node*> nodes;
+					_for_each_node(this->root.get(), [&nodes](const node& n){
+						if(!_is_dead(n)){
+							nodes.push_back(&n);
+						}
+					});
+					std::vector<image_record> records(nodes.size());
+					_fill_image(records, nodes, 0, nodes.size());
+					image_header header{{'A', 'V', 'L', 'I'}, image_version, (uint32_t)sizeof(image_record), (uint32_t)with_multiplicity::value, nodes.size(), 0};
+					_write(os, header);
+					os.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(image_record));
+				}
+				
+				// writes the elements in order, with a header. keys and values are written as their bytes, so they have to be trivially copyable
+				void save(std::ostream& os) const{
+					static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>, "save() is available only for trivially copyable keys and values");
+					const uint64_t n = with_multiplicity::value ? _count_nodes(this->root.get()) : this->size();
+					os.write("AVLT", 4);
+					_write(os, snapshot_version);
+					_write(os, (uint32_t)sizeof(K));
+					_write(os, (uint32_t)(with_value::value ? sizeof(V) : 0));
+					_write(os, (uint32_t)with_multiplicity::value);
+					_write(os, n);
+					if(this->root){
+						_save_node(os, *this->root);
+					}
+				}
+				
+#ifdef AVLTREE_DEBUG_CLASS
+				friend class AVLTREE_DEBUG_CLASS;
+#endif
+			};
+			
+			class tree_base_with_summary: public tree_base2{
+			private:
+				template<typename KA> typename summarizer::type summarize_(const node& cur, const query<KA>& l, const query<KA>& r){
+					typename summarizer::type summary(summarizer::identity_());
+					const bool in_l = _compare(l, cur) <= 0;
+					const bool in_r = _compare(r, cur) >= 0;
+					if(cur.l && in_l){
+						if(in_r){
+							summarizer::accumulate_(summary, summarize_l_<KA>(*cur.l, l));
+						}else{
+							summarizer::accumulate_(summary, summarize_<KA>(*cur.l, l, r));
+						}
+					}
+					if(in_l && in_r){
+						summarizer::accumulate_(summary, cur.own_summary());
+					}
+					if(cur.r && in_r){
+						if(in_l){
+							summarizer::accumulate_(summary, summarize_r_<KA>(*cur.r, r));
+						}else{
+							summarizer::accumulate_(summary, summarize_<KA>(*cur.r, l, r));
+						}
+					}
+					return summary;
+				}
+				template<typename KA> typename summarizer::type summarize_l_(const node& cur, const query<KA>& l){
+					if(_compare(l, cur) > 0){
+						if(cur.r){
+							return summarize_l_<KA>(*cur.r, l);
+						}else{
+							return summarizer::identity_();
+						}
+					}else{
+						typename summarizer::type summary(cur.own_summary());
+						if(cur.l){
+							summarizer::accumulate_(summary, summarize_l_<KA>(*cur.l, l));
+						}
+						if(cur.r){
+							summarizer::accumulate_(summary, cur.r->s);
+						}
+						return summary;
+					}
+				}
+				template<typename KA> typename summarizer::type summarize_r_(const node& cur, const query<KA>& r){
+					if(_compare(r, cur) < 0){
+						if(cur.l){
+							return summarize_r_<KA>(*cur.l, r);
+						}else{
+							return summarizer::identity_();
+						}
+					}else{
+						typename summarizer::type summary(cur.own_summary());
+						if(cur.r){
+							summarizer::accumulate_(summary, summarize_r_<KA>(*cur.r, r));
+						}
+						if(cur.l){
+							summarizer::accumulate_(summary, cur.l->s);
+						}
+						return summary;
+					}
+				}
+			public:
+				tree_base_with_summary(): tree_base2(){}
+				template<typename Q = K> inline typename summarizer::type summarize(const Q& l, const Q& r){
+					[[maybe_unused]] const auto scope = this->_measure(&operation_stats::summarize);
+					if(this->root){
+						const uint64_t comparisons = with_stats::value ? _comparisons : 0;
+						auto summary = summarize_<QR<Q>>(*this->root, query<QR<Q>>(l), query<QR<Q>>(r));
+						this->_count_search(0, comparisons);
+						return summary;
+					}else{
+						return summarizer::identity_();
+					}
+				}
+				inline typename summarizer::type summarize(const node_view& l, const node_view& r){
+					return summarize<K>(*l, *r);
+				}
+			};
+			
+			class tree_base_with_summary_and_index: public tree_base_with_summary{
+				typename summarizer::type summarize_by_index_(const node& cur, size_t l, size_t r){
+					if(l >= r){
+						return summarizer::identity_();
+					}else if(l == 0 && r >= cur.c){
+						return cur.s;
+					}else{
+						typename summarizer::type summary(summarizer::identity_());
+						size_t cl;
+						if(cur.l){
+							cl = cur.l->c;
+							if(l < cl){
+								summarizer::accumulate_(summary, summarize_by_index_(*cur.l, l, r));
+							}
+						}else{
+							cl = 0;
+						}
+						const size_t cm = cl + cur.weight();
+						if(l < cm && r > cl){
+							summarizer::accumulate_(summary, cur.own_summary(std::min(r, cm) - std::max(l, cl)));
+						}
+						if(cur.r){
+							if(r > cm){
+								summarizer::accumulate_(summary, summarize_by_index_(*cur.r, l > cm ? l - cm : 0, r - cm));
+							}
+						}
+						return summary;
+					}
+				}
+			public:
+				tree_base_with_summary_and_index(): tree_base_with_summary(){}
+				typename summarizer::type summarize_by_index(size_t l, size_t r){
+					[[maybe_unused]] const auto scope = this->_measure(&operation_stats::summarize);
+					if(this->root){
+						return summarize_by_index_(*this->root, l, r);
+					}else{
+						return summarizer::identity_();
+					}
+				}
+			};
+			
+			using tree_base = std::conditional_t<with_summary::value, std::conditional_t<with_index::value, tree_base_with_summary_and_index, tree_base_with_summary>, tree_base2>;
+			
+			
+			class multiset_base0: public tree_base{
+				// equal values are put into the lower side of the subtree
+				inline static int _branch_eq(const node& cur, int cmp){
+					if(cmp == 0){
+						return cur.balance() > 0 ? 1 : -1;
+					}else{
+						return cmp;
+					}
+				}
+				template<typename KA> inline static branch_func _make_branch_eq(KA k){
+					return [q = query<KA>(k)](const node& cur){ return _branch_eq(cur, _compare(q, cur)); };
+				}
+			protected:
+				multiset_base0(): tree_base(){}
+				inline void _insert_node(node_uptr&& n){
+					[[maybe_unused]] const auto scope = this->_measure(&operation_stats::insert);
+					auto [slot, height] = this->_find(_make_branch_eq<KR>(n->key()));
+					this->_link(slot, std::move(n), height);
+				}
+			public:
+				template<typename V_> bool insert(V_&& v){
+					[[maybe_unused]] const auto scope = this->_measure(&operation_stats::insert);
+					auto [new_node, height] = this->_find(_make_branch_eq<KR>(v));
+					new_node = this->_new_node(std::forward<V_>(v));
+					this->template _fix_balance<1>(new_node, height);
+					return true;
+				}
+				// links the node removed from a multiset of the same type, without allocation
+				bool insert(node_uptr_view&& n){
+					node_uptr n_ = _release(std::move(n));
+					if(!n_){
+						return false;
+					}
+					_insert_node(std::move(n_));
+					return true;
+				}
+				template<typename... A> bool emplace(A&&... a){
+					_insert_node(this->_new_node(std::forward<A>(a)...));
+					return true;
+				}
+				// replaces an element equal to x with v, reusing its node. the size never changes in between
+				// the node is overwritten in place if v stays between its neighbors, or else moved without allocation
+				template<typename Q = K, typename V_> bool replace(const Q& x, V_&& v){
+					[[maybe_unused]] const auto scope = this->_measure(&operation_stats::insert);
+					auto [slot, height] = this->_find(tree_base0::template _make_branch_eq<QR<Q>>(x));
+					if(!slot){
+						return false;
+					}
+					if(this->_fits(slot, height, v)){
+						// the hash entry is placed by the key, so it moves with the key
+						if constexpr(with_hash_index::value){
+							this->_hash_erase(slot.get());
+						}
+						slot->key() = std::forward<V_>(v);
+						if constexpr(with_key_prefix::value){
+							slot->p = _digest(slot->key());
+						}
+						if constexpr(with_hash_index::value){
+							this->_hash_insert(slot.get());
+						}
+						this->_update_path(*slot, height, 0);
+					}else{
+						node_uptr n = this->_remove(slot, height);
+						n->key() = std::forward<V_>(v);
+						auto [new_slot, new_height] = this->_find(_make_branch_eq<KR>(n->key()));
+						this->_link(new_slot, std::move(n), new_height);
+					}
+					return true;
+				}
+			};
+			
+			class multiset_with_index: public multiset_base0{
+				template<int D> inline static int _branch_index(size_t& index, size_t& index_tmp, const node& cur, int cmp){
+					if(cmp < 0){
+						return -1;
+					}else if(cmp > 0){
+						index_tmp += (cur.l ? cur.l->c : 0) + 1;
+						return 1;
+					}else{
+						index = index_tmp + (cur.l ? cur.l->c : 0);
+						if(D == 1){
+							index_tmp += (cur.l ? cur.l->c : 0) + 1;
+							return 1;
+						}else{
+							return -1;
+						}
+					}
+				}
+				// equal values are on both sides, so the descent continues until a leaf
+				inline static int _branch_ge(const node& cur, const node*& cand, int cmp){
+					if(cmp <= 0){
+						cand = &cur;
+						return -1;
+					}else{
+						return 1;
+					}
+				}
+				inline static int _branch_le(const node& cur, const node*& cand, int cmp){
+					if(cmp >= 0){
+						cand = &cur;
+						return 1;
+					}else{
+						return -1;
+					}
+				}
+				template<int D, typename KA> inline size_t _index(KA k) const{
+					size_t index = this->size(), index_tmp = 0;
+					const query<KA> q(k);
+					this->_find([&q, &index, &index_tmp](const node&cur){ return _branch_index<D>(index, index_tmp, cur, _compare(q, cur)); });
+					return index;
+				}
+			protected:
+				multiset_with_index(): multiset_base0(){}
+			public:
+				template<typename Q = K> inline size_t index(const Q& k) const{ return this->_index<-1, QR<Q>>(k); }
+				template<typename Q = K> inline size_t last_index(const Q& k) const{ return this->_index<1, QR<Q>>(k); }
+				template<typename Q = K> inline size_t count(const Q& k) const{
+					size_t first = index(k);
+					if(first == this->size()){
+						return 0;
+					}else{
+						return last_index(k) - first + 1;
+					}
+				}
+				template<typename Q = K> inline std::tuple<const node_view, size_t> find_ge_with_index(const Q& k) const{ return this->template _find_nearest_with_index<_branch_ge, QR<Q>>(k); }
+				template<typename Q = K> inline std::tuple<const node_view, size_t> find_le_with_index(const Q& k) const{ return this->template _find_nearest_with_index<_branch_le, QR<Q>>(k); }
+				template<typename Q = K> inline std::tuple<const node_view, size_t> find_gt_with_index(const Q& k) const{ return this->template _find_nearest_with_index<tree_base0::_branch_gt, QR<Q>>(k); }
+				template<typename Q = K> inline std::tuple<const node_view, size_t> find_lt_with_index(const Q& k) const{ return this->template _find_nearest_with_index<tree_base0::_branch_lt, QR<Q>>(k); }
+			};
+			
+			/*
+				MULTISET WITH MULTIPLICITY : equal values share a node, which holds the number of the copies
+			*/
+			
+			class multiset_with_multiplicity: public tree_base{
+				inline std::tuple<const node_view, size_t> _to_last(std::tuple<const node_view, size_t>&& found) const{
+					auto& [n, i] = found;
+					if(n){
+						i += n.multiplicity() - 1;
+					}
+					return std::move(found);
+				}
+			protected:
+				multiset_with_multiplicity(): tree_base(){}
+				inline void _insert_node(node_uptr&& n){
+					[[maybe_unused]] const auto scope = this->_measure(&operation_stats::insert);
+					auto [slot, height] = this->_find(tree_base0::template _make_branch_eq<KR>(n->key()));
+					if(slot){
+						slot->m += n->m;
+						this->_update_path(*slot, height, n->m);
+					}else{
+						this->_link(slot, std::move(n), height);
+					}
+				}
+			public:
+				template<typename V_> bool insert(V_&& v){ return this->_insert_copy(std::forward<V_>(v)); }
+				// links the node removed from a multiset of the same type, or adds its copies to the node of the same value
+				bool insert(node_uptr_view&& n){
+					node_uptr n_ = _release(std::move(n));
+					if(!n_){
+						return false;
+					}
+					_insert_node(std::move(n_));
+					return true;
+				}
+				template<typename... A> bool emplace(A&&... a){ return this->_insert_copy(K(std::forward<A>(a)...)); }
+				template<typename Q = K> inline size_t count(const Q& k) const{
+					const node* n = this->_find(tree_base0::template _make_branch_eq<QR<Q>>(k));
+					return n ? n->m : 0;
+				}
+				template<typename Q = K> inline size_t last_index(const Q& k) const{
+					size_t index = 0;
+					const node* n = this->_find(tree_base0::template _make_branch_calc_index<QR<Q>>(index, k));
+					return n ? index + n->m - 1 : this->size();
+				}
+				template<typename Q = K> inline std::tuple<const node_view, size_t> find_le_with_index(const Q& k) const{ return _to_last(tree_base::find_le_with_index(k)); }
+				template<typename Q = K> inline std::tuple<const node_view, size_t> find_lt_with_index(const Q& k) const{ return _to_last(tree_base::find_lt_with_index(k)); }
+			};
+			
+			using multiset_base = std::conditional_t<with_multiplicity::value, multiset_with_multiplicity, std::conditional_t<with_index::value, multiset_with_index, multiset_base0>>;
+		};
+	}
+	
+	template<typename K, typename V, tree_spec S = tree_spec::simple, typename U = std::tuple<>, typename C = std::less<K>> class map: public avltree_base::avltree<K, V, S, U, C>::tree_base{
+		static_assert(!tree_spec_has(S, avltree::tree_spec::with_multiplicity), "invalid tree_spec: with_multiplicity is available only for multiset");
+#ifdef AVLTREE_DEBUG_CLASS
+		friend class AVLTREE_DEBUG_CLASS;
+		using K_ = K;
+		using V_ = V;
+		inline static const avltree::tree_spec S_ = S;
+#endif
+		
+		using base           = typename avltree_base::avltree<K, V, S, U, C>;
+		using super          = typename base::tree_base;
+		using KR             = typename base::KR;
+		using VR             = typename base::VR;
+		using data_type      = typename base::data_type;
+		using iterator       = typename base::iterator;
+		inline static KR get_key(const data_type& data){ return data.first; }
+		inline static VR get_value(const data_type& data){ return data.second; }
+	public:
+		using key_type      = K;
+		using value_type    = V;
+		using key_compare   = C;
+		inline static const avltree::tree_spec tree_spec = S;
+		using with_index    = typename base::with_index;
+		using with_depth    = typename base::with_depth;
+		using with_wavl     = typename base::with_wavl;
+		using with_extremes = typename base::with_extremes;
+		using with_tombstone = typename base::with_tombstone;
+		using with_value    = typename base::with_value;
+		using image_view    = typename base::image_view;
+		using node_view      = typename base::node_view;
+		using node_uptr_view = typename base::node_uptr_view;
+		
+		map(): super(){}
+		template<class InputIter> map(InputIter first, InputIter last): super(){
+			for(auto p = first; p != last; p ++){
+				const auto& [k, v] = *p;
+				this->insert(k, v);
+			}
+		}
+		template<typename K_, typename V_> bool insert(K_&& k, V_&& v){
+			return this->_insert(std::forward<K_>(k), std::forward<V_>(v));
+		}
+		template<typename K_, typename V_> bool insert_or_assign(K_&& k, V_&& v){
+			return this->_insert(std::forward<K_>(k), std::forward<V_>(v));
+		}
+		// links the node removed from a map of the same type, without allocation
+		bool insert(node_uptr_view&& n){
+			return this->_insert_node(std::move(n));
+		}
+		// inserts or assigns the pairs of key and value in [first, last) at once: in order one by one if the range is small relative to the tree, or else by splitting and joining the tree in O(n log(N / n + 1)).
+		// the last one of equal keys in the range wins. returns the number of the keys not contained before
+		template<typename I> size_t insert_batch(I first, I last){
+			return this->_insert_batch(first, last);
+		}
+		template<typename K_, typename... A> bool try_emplace(K_&& k, A&&... a){
+			return this->_try_emplace(std::forward<K_>(k), std::forward<A>(a)...);
+		}
+		template<typename... A> bool emplace(A&&... a){
+			return this->_emplace(std::forward<A>(a)...);
+		}
+		// replaces the contents with the snapshot written by save(). on failure, the map becomes empty and false is returned
+		bool load(std::istream& is){
+			return this->_load(is, false);
+		}
+		// replaces the contents with the stream written by export_stream(). on failure, the map becomes empty and false is returned
+		bool import_stream(std::istream& is){
+			return this->_import_stream(is, false);
+		}
+		// applies the delta written by checkpoint_delta() of a map holding the same contents as this one at the previous checkpoint
+		bool apply_delta(std::istream& is){
+			return this->_apply_delta(is, [this](auto&& n){ this->_insert_node(std::move(n)); });
+		}
+		
+		using iterator_key   = avltree_base::iterator_wrapper<iterator, const data_type&, KR, get_key>;
+		using iterator_value = avltree_base::iterator_wrapper<iterator, const data_type&, VR, get_value>;
+		
+		inline iterator_key   key_begin()   const { return iterator_key(this->begin()); }
+		inline iterator_value value_begin() const { return iterator_value(this->begin()); }
+		
+		auto reversed() const { return avltree_base::iterator_pair([this](){ return this->rbegin();      }, [this](){ return this->end(); }); }
+		auto keys()     const { return avltree_base::iterator_pair([this](){ return this->key_begin();   }, [this](){ return this->end(); }); }
+		auto values()   const { return avltree_base::iterator_pair([this](){ return this->value_begin(); }, [this](){ return this->end(); }); }
+	
+		template<typename X, X summarize(const X& a, const X& b), X identity(), X get(const typename base::data_type&) = summarizer::pass<data_type>> using with_summary = map<K, V, S, summarizer::tuple_append<U, typename summarizer::single<K, V, S, X, summarize, identity, get>>, C>;
+		
+// can be used only in C++ 20 or over
+//		template<typename X = int> using with_summary_key_sum    = with_summary<K, summarizer::add, summarizer::zero, summarizer::get_key>;
+//		template<typename X = int> using with_summary_key_prod   = with_summary<K, summarizer::mul, summarizer::one,  summarizer::get_key>;
+//		template<typename X = int> using with_summary_value_sum  = with_summary<V, summarizer::add, summarizer::zero, summarizer::get_value>;
+//		template<typename X = int> using with_summary_value_prod = with_summary<V, summarizer::mul, summarizer::one,  summarizer::get_value>;
+//		template<typename X = int> using with_summary_value_min  = with_summary<V, summarizer::min, summarizer::max_value, summarizer::get_value>;
+//		template<typename X = int> using with_summary_value_max  = with_summary<V, summarizer::max, summarizer::min_value, summarizer::get_value>;
+	};
+
+	template<typename V, tree_spec S = tree_spec::simple, typename U = std::tuple<>, typename C = std::less<V>> class set: public avltree_base::avltree<V, avltree_base::empty, S, U, C>::tree_base{
+		static_assert(!tree_spec_has(S, avltree::tree_spec::with_multiplicity), "invalid tree_spec: with_multiplicity is available only for multiset");
+		using K_ = V;
+		using V_ = avltree_base::empty;
+#ifdef AVLTREE_DEBUG_CLASS
+		friend class AVLTREE_DEBUG_CLASS;
+		inline static const avltree::tree_spec S_ = S;
+#endif
+		using base  = typename avltree_base::avltree<V, avltree_base::empty, S, U, C>;
+		using super = typename base::tree_base;
+	public:
+		using value_type     = V;
+		using key_compare    = C;
+		inline static const avltree::tree_spec tree_spec = S;
+		using with_index     = typename base::with_index;
+		using with_depth     = typename base::with_depth;
+		using with_wavl      = typename base::with_wavl;
+		using with_extremes  = typename base::with_extremes;
+		using with_tombstone = typename base::with_tombstone;
+		using with_value     = typename std::false_type;
+		using node_view      = typename base::node_view;
+		using node_uptr_view = typename base::node_uptr_view;
+		using image_view     = typename base::image_view;
+		set(): super(){}
+		template<class InputIter> set(InputIter first, InputIter last): super(){
+			for(auto p = first; p != last; p ++){
+				this->insert(*p);
+			}
+		}
+		template<typename V_> bool insert(V_&& v){
+			return this->_insert(std::forward<V_>(v));
+		}
+		// links the node removed from a set of the same type, without allocation
+		bool insert(node_uptr_view&& n){
+			return this->_insert_node(std::move(n));
+		}
+		// inserts the values in [first, last) at once, as map::insert_batch(). returns the number of the values not contained before
+		template<typename I> size_t insert_batch(I first, I last){
+			return this->_insert_batch(first, last);
+		}
+		template<typename... A> bool emplace(A&&... a){
+			return this->_emplace(std::forward<A>(a)...);
+		}
+		// replaces the contents with the snapshot written by save(). on failure, the set becomes empty and false is returned
+		bool load(std::istream& is){
+			return this->_load(is, false);
+		}
+		// replaces the contents with the stream written by export_stream(). on failure, the set becomes empty and false is returned
+		bool import_stream(std::istream& is){
+			return this->_import_stream(is, false);
+		}
+		// applies the delta written by checkpoint_delta() of a set holding the same contents as this one at the previous checkpoint
+		bool apply_delta(std::istream& is){
+			return this->_apply_delta(is, [this](auto&& n){ this->_insert_node(std::move(n)); });
+		}
+		
+		template<typename X, X summarize(const X& a, const X& b), X identity(), X get(const typename base::data_type&) = summarizer::pass<X>> using with_summary = set<V, S, summarizer::tuple_append<U, typename summarizer::single<K_, V_, S, X, summarize, identity, get>>, C>;
+	};
+	
+	template<typename V, tree_spec S = tree_spec::simple, typename U = std::tuple<>, typename C = std::less<V>> class multiset: public avltree_base::avltree<V, avltree_base::empty, S, U, C>::multiset_base{
+		static_assert(!tree_spec_has(S, avltree::tree_spec::with_tombstone), "invalid tree_spec: with_tombstone is available only for map and set");
+		using K_ = V;
+		using V_ = avltree_base::empty;
+#ifdef AVLTREE_DEBUG_CLASS
+		friend class AVLTREE_DEBUG_CLASS;
+		inline static const avltree::tree_spec S_ = S;
+#endif
+		using base  = typename avltree_base::avltree<V, avltree_base::empty, S, U, C>;
+		using super = typename base::multiset_base;
+	public:
+		using value_type     = V;
+		using key_compare    = C;
+		inline static const avltree::tree_spec tree_spec = S;
+		using with_index     = typename base::with_index;
+		using with_depth     = typename base::with_depth;
+		using with_wavl      = typename base::with_wavl;
+		using with_extremes  = typename base::with_extremes;
+		using with_value     = typename std::false_type;
+		using with_multiplicity = typename base::with_multiplicity;
+		using node_view      = typename base::node_view;
+		using node_uptr_view = typename base::node_uptr_view;
+		using image_view     = typename base::image_view;
+		multiset(): super(){}
+		template<class InputIter> multiset(InputIter first, InputIter last): super(){
+			for(auto p = first; p != last; p ++){
+				this->insert(*p);
+			}
+		}
+		// inserts v, for the use as a priority queue with peek_min(), peek_max(), pop_first() and pop_last()
+		template<typename V_> void push(V_&& v){
+			this->insert(std::forward<V_>(v));
+		}
+		// replaces the contents with the snapshot written by save(). on failure, the multiset becomes empty and false is returned
+		bool load(std::istream& is){
+			return this->_load(is, !with_multiplicity::value);
+		}
+		// replaces the contents with the stream written by export_stream(). on failure, the multiset becomes empty and false is returned
+		bool import_stream(std::istream& is){
+			return this->_import_stream(is, !with_multiplicity::value);
+		}
+		// the ranges of a delta are bounded by keys, which cannot tell apart the elements of equal keys without with_multiplicity
+		void checkpoint_delta(std::ostream& os){
+			static_assert(with_multiplicity::value, "checkpoint_delta() of multiset is available only with tree_spec::with_multiplicity");
+			super::checkpoint_delta(os);
+		}
+		// applies the delta written by checkpoint_delta() of a multiset holding the same contents as this one at the previous checkpoint
+		bool apply_delta(std::istream& is){
+			static_assert(with_multiplicity::value, "apply_delta() of multiset is available only with tree_spec::with_multiplicity");
+			return this->_apply_delta(is, [this](auto&& n){ this->_insert_node(std::move(n)); });
+		}
+		template<typename X, X summarize(const X& a, const X& b), X identity(), X get(const typename base::data_type&) = summarizer::pass<X>> using with_summary = multiset<V, S, summarizer::tuple_append<U, typename summarizer::single<K_, V_, S, X, summarize, identity, get>>, C>;
+	};
+	
+	template<typename T> using with_summary_key_sum    = typename T::template with_summary<typename T::key_type,   summarizer::add, summarizer::zero<typename T::key_type>, summarizer::get_key>;
+	template<typename T> using with_summary_key_prod   = typename T::template with_summary<typename T::key_type,   summarizer::mul, summarizer::one<typename T::key_type>,  summarizer::get_key>;
+	template<typename T> using with_summary_value_sum  = typename T::template with_summary<typename T::value_type, summarizer::add, summarizer::zero<typename T::value_type>, summarizer::get_value>;
+	template<typename T> using with_summary_value_prod = typename T::template with_summary<typename T::value_type, summarizer::mul, summarizer::one<typename T::value_type>,  summarizer::get_value>;
+	template<typename T> using with_summary_value_min  = typename T::template with_summary<typename T::value_type, summarizer::min, summarizer::max_value<typename T::value_type>, summarizer::get_value>;
+	template<typename T> using with_summary_value_max  = typename T::template with_summary<typename T::value_type, summarizer::max, summarizer::min_value<typename T::value_type>, summarizer::get_value>;
+	
+	template<typename T> using with_summary_sum  = typename T::template with_summary<typename T::value_type, summarizer::add, summarizer::zero<typename T::value_type>>;
+	template<typename T> using with_summary_prod = typename T::template with_summary<typename T::value_type, summarizer::mul, summarizer::one<typename T::value_type>>;
+	
+	/*
+		SMALL CONTAINERS : inline sorted arrays for tiny sets
+	*/
+	
+	namespace avltree_base{
+		template<typename T> struct small_traits;
+		template<typename V, tree_spec S, typename U, typename C> struct small_traits<set<V, S, U, C>>{
+			using summarizer = summarizer::tuple_to_summarizer<V, empty, S, U>;
+			static constexpr bool unique = true;
+		};
+		template<typename V, tree_spec S, typename U, typename C> struct small_traits<multiset<V, S, U, C>>{
+			using summarizer = summarizer::tuple_to_summarizer<V, empty, S, U>;
+			static constexpr bool unique = false;
+		};
+	}
+	
+	// holds up to N values in an inline sorted array without any allocation, and moves them into T, avltree::set or avltree::multiset, only when it grows beyond N.
+	// it moves back to the array when the size falls to N / 2. lookups return pointers to the values like image_view, which are valid until the value is removed or the layout changes
+	template<typename T, size_t N = 16> class small{
+		using traits = avltree_base::small_traits<T>;
+		using V = typename T::value_type;
+		using C = typename T::key_compare;
+		using summarizer = typename traits::summarizer;
+		using tree_iterator = decltype(std::declval<const T&>().begin());
+		static_assert(N > 0, "small requires N > 0");
+		
+		struct inline_array{
+			std::array<V, N> a;
+			size_t n;
+		};
+		std::variant<inline_array, T> v;
+		
+		inline inline_array* _small(){ return std::get_if<inline_array>(&v); }
+		inline const inline_array* _small() const{ return std::get_if<inline_array>(&v); }
+		inline static const V* _ptr(const typename T::node_view& n){ return n ? &*n : nullptr; }
+		// the number of values less than k, or not greater than k if G is true.
+		// the loop runs over the whole array without branches, so that it is vectorized for arithmetic types
+		template<bool G, typename Q> inline static size_t _bound(const inline_array& s, const Q& k){
+			size_t i = 0;
+			for(size_t j = 0; j < N; j ++){
+				i += (j < s.n) & (G ? !C()(k, s.a[j]) : C()(s.a[j], k));
+			}
+			return i;
+		}
+		inline void _grow(){
+			inline_array s = std::move(std::get<inline_array>(v));
+			T& t = v.template emplace<T>();
+			for(size_t i = 0; i < s.n; i ++){
+				t.insert(std::move(s.a[i]));
+			}
+		}
+		inline void _shrink(){
+			inline_array s{};
+			s.n = 0;
+			for(const auto& x: std::get<T>(v)){
+				s.a[s.n ++] = x;
+			}
+			v = std::move(s);
+		}
+		template<typename Z = summarizer> inline static typename Z::type _summarize(const inline_array& s, size_t lo, size_t hi){
+			typename Z::type result(Z::identity_());
+			for(size_t i = lo; i < hi; i ++){
+				Z::accumulate_(result, Z::get_(s.a[i]));
+			}
+			return result;
+		}
+	public:
+		using value_type = V;
+		using tree_type  = T;
+		
+		// iterates over the values in order, in the inline array or in the tree. compared with end(), which is nullptr as in T.
+		// invalidated by an update, as the values may move between the array and the tree
+		class iterator{
+			struct range{
+				const V* p;
+				const V* e;
+			};
+			std::variant<range, tree_iterator> i;
+		public:
+			inline explicit iterator(const V* p, const V* e): i(range{p, e}){}
+			inline explicit iterator(tree_iterator&& t): i(std::move(t)){}
+			inline const V& operator*() const{
+				if(auto r = std::get_if<range>(&i)){
+					return *r->p;
+				}
+				return *std::get<tree_iterator>(i);
+			}
+			inline const V* operator->() const{ return &**this; }
+			inline iterator& operator++(){
+				if(auto r = std::get_if<range>(&i)){
+					++ r->p;
+				}else{
+					++ std::get<tree_iterator>(i);
+				}
+				return *this;
+			}
+			inline iterator operator++(int){ auto i_ = *this; ++ *this; return i_; }
+			inline bool operator==(std::nullptr_t) const{
+				if(auto r = std::get_if<range>(&i)){
+					return r->p == r->e;
+				}
+				return std::get<tree_iterator>(i) == nullptr;
+			}
+			inline bool operator!=(std::nullptr_t n) const{ return !(*this == n); }
+		};
+		
+		small(): v(inline_array{{}, 0}){}
+		
+		// for a set, returns false if an equal value is already contained
+		template<typename V_> bool insert(V_&& x){
+			if(auto s = _small()){
+				const size_t i = _bound<false>(*s, x);
+				if constexpr(traits::unique){
+					if(i < s->n && !C()(x, s->a[i])){
+						return false;
+					}
+				}
+				if(s->n < N){
+					std::move_backward(s->a.begin() + i, s->a.begin() + s->n, s->a.begin() + s->n + 1);
+					s->a[i] = std::forward<V_>(x);
+					s->n ++;
+					return true;
+				}
+				_grow();
+			}
+			return std::get<T>(v).insert(std::forward<V_>(x));
+		}
+		// removes one value equal to x, and returns whether it was contained
+		template<typename Q = V> bool remove(const Q& x){
+			if(auto s = _small()){
+				const size_t i = _bound<false>(*s, x);
+				if(i == s->n || C()(x, s->a[i])){
+					return false;
+				}
+				std::move(s->a.begin() + i + 1, s->a.begin() + s->n, s->a.begin() + i);
+				s->n --;
+				s->a[s->n] = V();
+				return true;
+			}
+			T& t = std::get<T>(v);
+			if(!t.remove(x)){
+				return false;
+			}
+			if(t.size() <= N / 2){
+				_shrink();
+			}
+			return true;
+		}
+		
+		template<typename Q = V> const V* find(const Q& x) const{
+			if(auto s = _small()){
+				const size_t i = _bound<false>(*s, x);
+				return i < s->n && !C()(x, s->a[i]) ? &s->a[i] : nullptr;
+			}
+			return _ptr(std::get<T>(v).find(x));
+		}
+		template<typename Q = V> inline bool contains(const Q& x) const{ return find(x) != nullptr; }
+		template<typename Q = V> const V* find_ge(const Q& x) const{
+			if(auto s = _small()){
+				const size_t i = _bound<false>(*s, x);
+				return i < s->n ? &s->a[i] : nullptr;
+			}
+			return _ptr(std::get<T>(v).find_ge(x));
+		}
+		template<typename Q = V> const V* find_gt(const Q& x) const{
+			if(auto s = _small()){
+				const size_t i = _bound<true>(*s, x);
+				return i < s->n ? &s->a[i] : nullptr;
+			}
+			return _ptr(std::get<T>(v).find_gt(x));
+		}
+		template<typename Q = V> const V* find_le(const Q& x) const{
+			if(auto s = _small()){
+				const size_t i = _bound<true>(*s, x);
+				return i > 0 ? &s->a[i - 1] : nullptr;
+			}
+			return _ptr(std::get<T>(v).find_le(x));
+		}
+		template<typename Q = V> const V* find_lt(const Q& x) const{
+			if(auto s = _small()){
+				const size_t i = _bound<false>(*s, x);
+				return i > 0 ? &s->a[i - 1] : nullptr;
+			}
+			return _ptr(std::get<T>(v).find_lt(x));
+		}
+		
+		inline size_t size() const{
+			if(auto s = _small()){
+				return s->n;
+			}
+			return std::get<T>(v).size();
+		}
+		inline bool empty() const{ return size() == 0; }
+		inline iterator begin() const{
+			if(auto s = _small()){
+				return iterator(s->a.data(), s->a.data() + s->n);
+			}
+			return iterator(std::get<T>(v).begin());
+		}
+		inline std::nullptr_t end() const{ return nullptr; }
+		// whether the values are in the inline array
+		inline bool is_small() const{ return _small() != nullptr; }
+		
+		// the following are available on the tree only with tree_spec::with_index
+		const V* at(size_t i) const{
+			if(auto s = _small()){
+				return i < s->n ? &s->a[i] : nullptr;
+			}
+			return _ptr(std::get<T>(v).at(i));
+		}
+		// the index of the first value equal to x, or size() if not contained
+		template<typename Q = V> size_t index(const Q& x) const{
+			if(auto s = _small()){
+				const size_t i = _bound<false>(*s, x);
+				return i < s->n && !C()(x, s->a[i]) ? i : s->n;
+			}
+			return std::get<T>(v).index(x);
+		}
+		template<typename Q = V> size_t count(const Q& x) const{
+			if(auto s = _small()){
+				return _bound<true>(*s, x) - _bound<false>(*s, x);
+			}
+			if constexpr(traits::unique){
+				return std::get<T>(v).contains(x) ? 1 : 0;
+			}else{
+				return std::get<T>(v).count(x);
+			}
+		}
+		// the summary of the values not less than x_s and not greater than x_e, as T::summarize()
+		template<typename Q = V, typename Z = summarizer> typename Z::type summarize(const Q& x_s, const Q& x_e){
+			if(auto s = _small()){
+				return _summarize(*s, _bound<false>(*s, x_s), std::max(_bound<false>(*s, x_s), _bound<true>(*s, x_e)));
+			}
+			return std::get<T>(v).summarize(x_s, x_e);
+		}
+		template<typename Z = summarizer> typename Z::type summarize_by_index(size_t i_s, size_t i_e){
+			if(auto s = _small()){
+				i_e = std::min(i_e, s->n);
+				return _summarize(*s, std::min(i_s, i_e), i_e);
+			}
+			return std::get<T>(v).summarize_by_index(i_s, i_e);
+		}
+		
+		// calls f for each value in order
+		template<typename F> void for_each(F&& f) const{
+			if(auto s = _small()){
+				for(size_t i = 0; i < s->n; i ++){
+					f(s->a[i]);
+				}
+			}else{
+				for(const auto& x: std::get<T>(v)){
+					f(x);
+				}
+			}
+		}
+	};
+	
+	/*
+		FOREST : many small trees sharing one node arena
+	*/
+	
+	// whether the trees of spec hold a state out of the nodes, such as the generation, the extremes, the hash index or the count of tombstones, which the trees of a forest cannot share
+	inline constexpr bool tree_spec_holds_state_out_of_nodes(const tree_spec spec){
+		return tree_spec_has(spec, tree_spec::with_generation | tree_spec::with_extremes | tree_spec::with_hash_index | tree_spec::with_tombstone);
+	}
+	
+	// holds the nodes of many trees of type T in one arena, where each tree is referred by a handle of one pointer.
+	// T must be specified with tree_spec::with_arena and with_index, and without with_generation, with_extremes, with_hash_index and with_tombstone, which hold the state out of the nodes.
+	// the operations borrow one working tree of T, so that its path stack is shared by all trees. all nodes are freed at once by the destructor, without calling the destructors of the elements
+	template<typename T> class forest{
+		static_assert(tree_spec_has(T::tree_spec, tree_spec::with_arena), "forest requires tree_spec::with_arena");
+		static_assert(tree_spec_has(T::tree_spec, tree_spec::with_index), "forest requires tree_spec::with_index");
+		static_assert(!tree_spec_holds_state_out_of_nodes(T::tree_spec), "forest is not available with tree_spec::with_generation, with_extremes, with_hash_index or with_tombstone");
+		
+		struct work_tree : public T{
+			using T::root;
+		};
+		using node = typename decltype(work_tree::root)::element_type;
+		static_assert(std::is_trivially_destructible_v<decltype(node::data)>, "forest frees the elements without their destructors");
+		static_assert(alignof(node) <= alignof(std::max_align_t), "forest cannot align the nodes");
+	public:
+		// a tree in the forest, which is empty when constructed. it is valid until the forest is destroyed, and the nodes stay in the arena until clear() is called on it
+		class handle{
+			node* n;
+			friend class forest;
+		public:
+			inline handle(): n(nullptr){}
+			inline handle(handle&& h): n(std::exchange(h.n, nullptr)){}
+			inline handle& operator=(handle&& h){
+				n = std::exchange(h.n, nullptr);
+				return *this;
+			}
+			handle(const handle&) = delete;
+			handle& operator=(const handle&) = delete;
+			inline bool empty() const{ return n == nullptr; }
+		};
+	private:
+		avltree_base::node_arena arena;
+		mutable work_tree work;
+		mutable bool leased;
+		
+		// lends the tree of h to the working tree, with the arena of this forest. the working tree holds one tree at a time, so nested operations on the same forest throw std::logic_error
+		class lease{
+			const forest& f;
+			node*& n;
+			avltree_base::node_arena* prev;
+		public:
+			inline lease(const forest& f_, node*& n_): f(f_), n(n_), prev(node::arena){
+				if(f.leased){
+					throw std::logic_error("avltree::forest: an operation on the forest is called during another one on it");
+				}
+				f.leased = true;
+				node::arena = const_cast<avltree_base::node_arena*>(&f.arena);
+				f.work.root.reset(n);
+			}
+			inline ~lease(){
+				n = f.work.root.release();
+				node::arena = prev;
+				f.leased = false;
+			}
+			lease(const lease&) = delete;
+		};
+	public:
+		forest(): arena(sizeof(node)), work(), leased(false){}
+		forest(const forest&) = delete;
+		forest& operator=(const forest&) = delete;
+		
+		// calls f(t) with the tree of h as t of T&, and returns its result.
+		// node_uptr_view, erased_range and the other owners of nodes obtained from t should be released in f, and the nodes must not be moved to other trees.
+		// the nodes released out of f, including those of copies of t, stay in the arena until the forest is destroyed, which must be after they are released
+		template<typename F> decltype(auto) modify(handle& h, F&& f){
+			lease l(*this, h.n);
+			return f(static_cast<T&>(work));
+		}
+		// calls f(t) with the tree of h as t of const T&, and returns its result
+		template<typename F> decltype(auto) read(const handle& h, F&& f) const{
+			node* n = h.n;
+			lease l(*this, n);
+			return f(static_cast<const T&>(work));
+		}
+		
+		template<typename... A> bool insert(handle& h, A&&... a){
+			return modify(h, [&](T& t){ return (bool)t.insert(std::forward<A>(a)...); });
+		}
+		template<typename Q> bool remove(handle& h, const Q& k){
+			return modify(h, [&](T& t){ return (bool)t.remove(k); });
+		}
+		template<typename Q> bool contains(const handle& h, const Q& k) const{
+			return read(h, [&](const T& t){ return (bool)t.find(k); });
+		}
+		// returns the nodes of the tree to the arena, and makes it empty
+		void clear(handle& h){
+			lease l(*this, h.n);
+			work.root.reset();
+		}
+		inline size_t size(const handle& h) const{ return h.n ? h.n->c : 0; }
+		
+		// nodes of all trees
+		inline size_t nodes() const{ return arena.size(); }
+		// bytes of the arena and the shared path stack, which are all the memory held by the forest but the handles
+		inline size_t reserved_bytes() const{ return arena.reserved_bytes() + work.memory_usage().scratch_bytes; }
+	};
+	
+	/*
+		SLIDING WINDOW : order statistics of the latest values in a stream
+	*/
+	
+	// keeps the latest values pushed within capacity and span. S must contain tree_spec::with_index and not with_multiplicity
+	template<typename V, tree_spec S = tree_spec::with_index, typename C = std::less<V>> class window_stats{
+		static_assert(tree_spec_has(S, tree_spec::with_index), "window_stats requires tree_spec::with_index");
+		static_assert(!tree_spec_has(S, tree_spec::with_multiplicity), "window_stats is not available with tree_spec::with_multiplicity");
+	public:
+		using tree_type = with_summary_sum<multiset<V, S, std::tuple<>, C>>;
+		using node_view = typename tree_type::node_view;
+	private:
+		tree_type t;
+		std::deque<std::pair<int64_t, V>> window; // values in the order of arrival, with their times
+		size_t capacity;
+		int64_t span;
+		// evicts the values out of the window at the time, and replaces the first one with *v if given
+		inline void _evict(int64_t time, size_t limit, const V* v){
+			while(!window.empty() && (window.size() > limit || time - window.front().first >= span)){
+				if(v){
+					t.replace(window.front().second, *v);
+					v = nullptr;
+				}else{
+					t.remove(window.front().second);
+				}
+				window.pop_front();
+			}
+			if(v){
+				t.insert(*v);
+			}
+		}
+	public:
+		// the window holds at most capacity values, which were pushed less than span before the latest time
+		explicit window_stats(size_t capacity_, int64_t span_ = std::numeric_limits<int64_t>::max()): t(), window(), capacity(std::max<size_t>(capacity_, 1)), span(span_){}
+		
+		// adds v at the time, which never decreases. the value evicted first is replaced with v in the tree, so the tree never grows or shrinks in between
+		void push(const V& v, int64_t time = 0){
+			_evict(time, capacity - 1, &v);
+			window.emplace_back(time, v);
+		}
+		// evicts the values out of the window at the time, without adding any value
+		void expire(int64_t time){
+			_evict(time, capacity, nullptr);
+		}
+		inline size_t size() const{ return window.size(); }
+		inline bool empty() const{ return window.empty(); }
+		
+		// the value at the q-quantile (0 <= q <= 1) by the nearest rank, i.e. the ceil(q * size())-th smallest one. nullptr if empty
+		inline const node_view quantile(double q) const{
+			const size_t n = size();
+			const double r = std::ceil(std::clamp(q, 0.0, 1.0) * n);
+			return t.at(r > 1 ? std::min((size_t)r, n) - 1 : 0);
+		}
+		// the lower median
+		inline const node_view median() const{ return quantile(0.5); }
+		// the number of values less than v
+		inline size_t rank(const V& v) const{ return std::get<1>(t.find_ge_with_index(v)); }
+		// the mean of the values left after dropping floor(trim * size()) values from each end. NaN if none is left
+		inline double trimmed_mean(double trim){
+			const size_t n = size();
+			const size_t drop = (size_t)(std::clamp(trim, 0.0, 0.5) * n);
+			if(n <= drop * 2){
+				return std::numeric_limits<double>::quiet_NaN();
+			}
+			return (double)t.summarize_by_index(drop, n - drop) / (double)(n - drop * 2);
+		}
+		inline double mean(){ return trimmed_mean(0.0); }
+		
+		inline const tree_type* operator->() const{ return &t; }
+		inline const tree_type& operator*() const{ return t; }
+	};
+	
+	/*
+		DURABILITY : operation log and snapshots on files
+	*/
+	
+	// when logged<T> flushes the log to the storage with fsync: never, at every commit(), or at every n-th commit()
+	enum class sync_policy : char { none, per_commit, every_n };
+	
+	namespace avltree_base{
+		template<typename T, typename = void> struct element_key{ using type = typename T::value_type; };
+		template<typename T> struct element_key<T, std::void_t<typename T::key_type>>{ using type = typename T::key_type; };
+		// whether T has insert_batch() taking the range of D, which map and set have
+		template<typename T, typename D, typename = void> struct has_insert_batch: std::false_type{};
+		template<typename T, typename D> struct has_insert_batch<T, D, std::void_t<decltype(std::declval<T&>().insert_batch(std::declval<D*>(), std::declval<D*>()))>>: std::true_type{};
+		
+		// a descriptor of a file or a directory, only to flush it to the storage
+		class sync_handle{
+			int fd;
+		public:
+			sync_handle(): fd(-1){}
+			explicit sync_handle(const std::string& path){
+#ifdef _WIN32
+				fd = _open(path.c_str(), _O_RDWR | _O_BINARY);
+#else
+				fd = ::open(path.c_str(), O_RDONLY);
+#endif
+			}
+			~sync_handle(){
+				if(fd >= 0){
+#ifdef _WIN32
+					_close(fd);
+#else
+					::close(fd);
+#endif
+				}
+			}
+			sync_handle(sync_handle&& x) noexcept: fd(std::exchange(x.fd, -1)){}
+			sync_handle& operator=(sync_handle&& x) noexcept{
+				std::swap(fd, x.fd);
+				return *this;
+			}
+			bool sync() const{
+#ifdef _WIN32
+				return fd >= 0 && _commit(fd) == 0;
+#else
+				return fd >= 0 && ::fsync(fd) == 0;
+#endif
+			}
+		};
+		// flushes the entries of the directory holding path, so that a file renamed into it stays after a crash
+		inline bool sync_directory_of(const std::string& path){
+#ifdef _WIN32
+			return true;
+#else
+			const size_t slash = path.rfind('/');
+			return sync_handle(slash == std::string::npos ? std::string(".") : slash == 0 ? std::string("/") : path.substr(0, slash)).sync();
+#endif
+		}
+	}
+	
+	// keeps map, set or multiset T durable. every update is appended to path + ".log", and checkpoint() writes the whole tree to path + ".snapshot"
+	template<typename T> class logged{
+		using K = typename avltree_base::element_key<T>::type;
+		using V = typename T::value_type;
+		using node_uptr_view = typename T::node_uptr_view;
+		using data_type = std::conditional_t<T::with_value::value, std::pair<K, V>, K>;
+		// the runs of insertions are replayed by insert_batch(), if T has it
+		using with_batch = avltree_base::has_insert_batch<T, data_type>;
+		enum op : char { op_insert = 1, op_remove, op_pop_first, op_pop_last, op_pop_at };
+		enum recovery { recovery_complete, recovery_torn, recovery_failed };
+		
+		T t;
+		std::string path;
+		std::ofstream log;
+		avltree_base::sync_handle log_sync;
+		uint64_t seq;     // number of the operations since the tree was created
+		size_t group;     // number of the operations flushed at once
+		size_t pending;
+		sync_policy sync;
+		size_t sync_every;
+		size_t commits;   // number of commit() since the last fsync
+		bool recovered;
+		
+		template<typename X> inline static void _write(std::ostream& os, const X& x){ os.write(reinterpret_cast<const char*>(&x), sizeof(X)); }
+		template<typename X> inline static bool _read(std::istream& is, X& x){ return (bool)is.read(reinterpret_cast<char*>(&x), sizeof(X)); }
+		inline static uint32_t _checksum(const std::string& bytes){
+			uint32_t h = 2166136261u;
+			for(const char c: bytes){
+				h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+			}
+			return h;
+		}
+		// reads size bytes in pieces, so that a broken size allocates no more than the file holds
+		inline static bool _read_bytes(std::istream& is, std::string& bytes, uint32_t size){
+			const uint32_t piece = 1 << 16;
+			bytes.clear();
+			for(uint32_t done = 0; done < size; done += piece){
+				const uint32_t n = std::min(piece, size - done);
+				bytes.resize(done + n);
+				if(!is.read(bytes.data() + done, n)){
+					return false;
+				}
+			}
+			return true;
+		}
+		// each record is led by its size and checksum, so a torn record at the tail is detected. the record is written before the tree is changed
+		void _append(const std::string& record){
+			_write(log, (uint32_t)record.size());
+			_write(log, _checksum(record));
+			log.write(record.data(), record.size());
+			if(!log){
+				throw std::runtime_error("avltree::logged: cannot write to " + path + ".log");
+			}
+			seq ++;
+			if(++ pending >= group && !commit()){
+				throw std::runtime_error("avltree::logged: cannot commit to " + path + ".log");
+			}
+		}
+		// whether nothing but zeros follows, as in the tail of a file extended by a write that did not complete
+		inline static bool _rest_is_blank(std::istream& in){
+			in.clear();
+			char c;
+			while(in.get(c)){
+				if(c != 0){
+					return false;
+				}
+			}
+			return true;
+		}
+		// inserts the run of the insertions collected by _apply()
+		void _insert_batch(std::vector<data_type>& batch){
+			if constexpr(with_batch::value){
+				t.insert_batch(std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+				batch.clear();
+			}
+		}
+		// applies the record. the insertions are collected in batch, which is inserted before any other operation
+		bool _apply(const std::string& record, std::vector<data_type>& batch){
+			const char* p = record.data();
+			const char* e = p + record.size();
+			const char o = *p ++;
+			K k;
+			uint64_t i;
+			if(o != op_insert){
+				_insert_batch(batch);
+			}
+			switch(o){
+			case op_insert:
+				if(!stream_codec<K>::decode(p, e, k, nullptr)){
+					return false;
+				}
+				if constexpr(T::with_value::value){
+					V v;
+					if(!stream_codec<V>::decode(p, e, v, nullptr)){
+						return false;
+					}
+					if constexpr(with_batch::value){
+						batch.emplace_back(std::move(k), std::move(v));
+					}else{
+						t.insert(std::move(k), std::move(v));
+					}
+				}else if constexpr(with_batch::value){
+					batch.push_back(std::move(k));
+				}else{
+					t.insert(std::move(k));
+				}
+				return true;
+			case op_remove:
+				if(!stream_codec<K>::decode(p, e, k, nullptr)){
+					return false;
+				}
+				t.remove(k);
+				return true;
+			case op_pop_first:
+				t.pop_first();
+				return true;
+			case op_pop_last:
+				t.pop_last();
+				return true;
+			case op_pop_at:
+				if constexpr(T::with_index::value){
+					if(stream_codec_base::get_varint(p, e, i)){
+						t.pop_at(i);
+						return true;
+					}
+				}
+				return false;
+			default:
+				return false;
+			}
+		}
+		// loads the snapshot and replays the operations logged after it, the runs of insertions at once by insert_batch() for map and set.
+		// only a record cut at the tail of the log is torn, and any other damage fails
+		recovery _recover(){
+			uint64_t snapshot_seq = 0;
+			std::ifstream snapshot(path + ".snapshot", std::ios::binary);
+			if(snapshot){
+				char magic[4];
+				if(!_read(snapshot, magic) || std::string_view(magic, 4) != "AVLC" || !_read(snapshot, snapshot_seq) || !t.import_stream(snapshot)){
+					return recovery_failed;
+				}
+			}
+			seq = snapshot_seq;
+			std::ifstream in(path + ".log", std::ios::binary);
+			if(!in){
+				return recovery_complete;
+			}
+			char magic[4];
+			uint64_t base;
+			// the log is cut in its header, if the process stopped while checkpoint() started it
+			if(!_read(in, magic) || !_read(in, base)){
+				return _rest_is_blank(in) ? recovery_torn : recovery_failed;
+			}
+			if(std::string_view(magic, 4) != "AVLL" || base > snapshot_seq){
+				return recovery_failed;
+			}
+			// the log written before the last snapshot may remain, if the process stopped during checkpoint()
+			std::string record;
+			std::vector<data_type> batch;
+			for(uint64_t s = base; ; s ++){
+				uint32_t size, checksum;
+				if(!_read(in, size)){
+					_insert_batch(batch);
+					return in.gcount() == 0 ? recovery_complete : recovery_torn;
+				}
+				if(size == 0 || !_read(in, checksum) || !_read_bytes(in, record, size) || _checksum(record) != checksum){
+					_insert_batch(batch);
+					return _rest_is_blank(in) ? recovery_torn : recovery_failed;
+				}
+				if(s >= snapshot_seq){
+					if(!_apply(record, batch)){
+						return recovery_failed;
+					}
+					seq = s + 1;
+				}
+			}
+		}
+	public:
+		// recovers the contents from the files at path, if any. the log is flushed every group operations, and synced by the policy sync.
+		// if the files are damaged, throws std::runtime_error and leaves them as they are
+		logged(const std::string& path_, size_t group_ = 1, sync_policy sync_ = sync_policy::none, size_t sync_every_ = 1): t(), path(path_), log(), log_sync(), seq(0), group(std::max<size_t>(group_, 1)), pending(0), sync(sync_), sync_every(std::max<size_t>(sync_every_, 1)), commits(0), recovered(false){
+			const recovery r = _recover();
+			if(r == recovery_failed){
+				throw std::runtime_error("avltree::logged: cannot recover from " + path + ".snapshot and " + path + ".log");
+			}
+			recovered = r == recovery_complete;
+			if(!checkpoint()){
+				throw std::runtime_error("avltree::logged: cannot write a checkpoint to " + path + ".snapshot");
+			}
+		}
+		~logged(){ commit(); }
+		logged(const logged&) = delete;
+		logged& operator=(const logged&) = delete;
+		
+		// whether the files were read to the end without any damage
+		inline bool good() const{ return recovered; }
+		inline const T& operator*() const{ return t; }
+		inline const T* operator->() const{ return &t; }
+		
+		template<typename... A> bool insert(const K& k, const A&... v){
+			static_assert(sizeof...(A) == (T::with_value::value ? 1 : 0), "insert() takes a key and a value for map, and a value for set and multiset");
+			std::string record(1, op_insert);
+			stream_codec<K>::encode(record, k, nullptr);
+			(stream_codec<V>::encode(record, v, nullptr), ...);
+			_append(record);
+			return t.insert(k, v...);
+		}
+		// node_uptr_view, or bool with tree_spec::with_tombstone as T::remove()
+		auto remove(const K& k){
+			std::string record(1, op_remove);
+			stream_codec<K>::encode(record, k, nullptr);
+			_append(record);
+			return t.remove(k);
+		}
+		node_uptr_view pop_first(){
+			_append(std::string(1, op_pop_first));
+			return t.pop_first();
+		}
+		node_uptr_view pop_last(){
+			_append(std::string(1, op_pop_last));
+			return t.pop_last();
+		}
+		node_uptr_view pop_at(size_t i){
+			std::string record(1, op_pop_at);
+			stream_codec_base::put_varint(record, i);
+			_append(record);
+			return t.pop_at(i);
+		}
+		
+		// flushes the logged operations to the file, and to the storage by the sync policy. returns false on an I/O error
+		bool commit(){
+			log.flush();
+			pending = 0;
+			if(!log){
+				return false;
+			}
+			if(sync == sync_policy::per_commit || (sync == sync_policy::every_n && ++ commits >= sync_every)){
+				commits = 0;
+				return log_sync.sync();
+			}
+			return true;
+		}
+		// writes the whole tree to the snapshot file, through a temporary file and a rename, and then starts a new log.
+		// the snapshot and the directory are synced before the old log is truncated. returns false on an I/O error, where the old log is kept
+		bool checkpoint(){
+			if(log.is_open() && !commit()){
+				return false;
+			}
+			const std::string tmp = path + ".snapshot.tmp";
+			{
+				std::ofstream snapshot(tmp, std::ios::binary | std::ios::trunc);
+				snapshot.write("AVLC", 4);
+				_write(snapshot, seq);
+				t.export_stream(snapshot);
+				snapshot.close();
+				if(!snapshot || !avltree_base::sync_handle(tmp).sync()){
+					std::remove(tmp.c_str());
+					return false;
+				}
+			}
+			if(std::rename(tmp.c_str(), (path + ".snapshot").c_str()) != 0 || !avltree_base::sync_directory_of(path)){
+				return false;
+			}
+			log.close();
+			log.open(path + ".log", std::ios::binary | std::ios::trunc);
+			log.write("AVLL", 4);
+			_write(log, seq);
+			log.flush();
+			log_sync = avltree_base::sync_handle(path + ".log");
+			pending = 0;
+			commits = 0;
+			return (bool)log && log_sync.sync() && avltree_base::sync_directory_of(path);
+		}
+	};
+	
+	/*
+		WORKLOAD TRACES : recording operations and replaying them on other trees
+	*/
+	
+	enum class trace_op : char { insert = 1, remove, pop_first, pop_last, pop_at, find, find_ge, find_le, at, index, summarize, summarize_by_index, scan };
+	
+	namespace avltree_base{
+		template<typename T, typename K, typename = void> struct has_summarize: std::false_type{};
+		template<typename T, typename K> struct has_summarize<T, K, std::void_t<decltype(std::declval<T&>().summarize(std::declval<const K&>(), std::declval<const K&>()))>>: std::true_type{};
+		
+		// keys and values are coded as the differences from the previous ones in the trace
+		template<typename K, typename V> struct trace_coder{
+			K k{};
+			V v{};
+			bool has_k = false, has_v = false;
+			void put_key(std::string& out, const K& x){
+				stream_codec<K>::encode(out, x, has_k ? &k : nullptr);
+				k = x;
+				has_k = true;
+			}
+			void put_value(std::string& out, const V& x){
+				stream_codec<V>::encode(out, x, has_v ? &v : nullptr);
+				v = x;
+				has_v = true;
+			}
+			bool get_key(const char*& p, const char* e, K& x){
+				if(!stream_codec<K>::decode(p, e, x, has_k ? &k : nullptr)){
+					return false;
+				}
+				k = x;
+				return has_k = true;
+			}
+			bool get_value(const char*& p, const char* e, V& x){
+				if(!stream_codec<V>::decode(p, e, x, has_v ? &v : nullptr)){
+					return false;
+				}
+				v = x;
+				return has_v = true;
+			}
+		};
+		
+		// visits at most n elements from the first one not less than k, and returns the number of them. equal keys of a multiset are all visited
+		template<typename T, typename K, typename F> size_t scan(const T& t, const K& k, size_t n, F f){
+			size_t visited = 0;
+			for(auto it = t.iterator_ge(k); it != nullptr && visited < n; ++ it, visited ++){
+				f(*it);
+			}
+			return visited;
+		}
+	}
+	
+	// records the operations on map, set or multiset T to os, in blocks of records led by their sizes, to replay them with trace_reader
+	template<typename T> class traced{
+		using K = typename avltree_base::element_key<T>::type;
+		using V = typename T::value_type;
+		using node_uptr_view = typename T::node_uptr_view;
+		
+		T t;
+		std::ostream& os;
+		std::string block;
+		avltree_base::trace_coder<K, V> coder;
+		uint64_t count;
+		
+		inline std::string& _begin(trace_op o){
+			block.push_back((char)o);
+			return block;
+		}
+		inline void _end(){
+			count ++;
+			if(block.size() >= 65536){
+				flush();
+			}
+		}
+	public:
+		explicit traced(std::ostream& os_): t(), os(os_), block(), coder(), count(0){
+			os.write("AVLR", 4);
+			os.put(T::with_value::value ? 1 : 0);
+		}
+		~traced(){ flush(); }
+		traced(const traced&) = delete;
+		traced& operator=(const traced&) = delete;
+		
+		// number of the recorded operations
+		inline uint64_t records() const{ return count; }
+		inline const T& operator*() const{ return t; }
+		inline const T* operator->() const{ return &t; }
+		
+		template<typename... A> bool insert(const K& k, const A&... v){
+			static_assert(sizeof...(A) == (T::with_value::value ? 1 : 0), "insert() takes a key and a value for map, and a value for set and multiset");
+			coder.put_key(_begin(trace_op::insert), k);
+			(coder.put_value(block, v), ...);
+			_end();
+			return t.insert(k, v...);
+		}
+		// node_uptr_view, or bool with tree_spec::with_tombstone as T::remove()
+		auto remove(const K& k){
+			coder.put_key(_begin(trace_op::remove), k);
+			_end();
+			return t.remove(k);
+		}
+		node_uptr_view pop_first(){
+			_begin(trace_op::pop_first);
+			_end();
+			return t.pop_first();
+		}
+		node_uptr_view pop_last(){
+			_begin(trace_op::pop_last);
+			_end();
+			return t.pop_last();
+		}
+		node_uptr_view pop_at(size_t i){
+			stream_codec_base::put_varint(_begin(trace_op::pop_at), i);
+			_end();
+			return t.pop_at(i);
+		}
+		auto find(const K& k){
+			coder.put_key(_begin(trace_op::find), k);
+			_end();
+			return t.find(k);
+		}
+		auto find_ge(const K& k){
+			coder.put_key(_begin(trace_op::find_ge), k);
+			_end();
+			return t.find_ge(k);
+		}
+		auto find_le(const K& k){
+			coder.put_key(_begin(trace_op::find_le), k);
+			_end();
+			return t.find_le(k);
+		}
+		auto at(size_t i){
+			stream_codec_base::put_varint(_begin(trace_op::at), i);
+			_end();
+			return t.at(i);
+		}
+		size_t index(const K& k){
+			coder.put_key(_begin(trace_op::index), k);
+			_end();
+			return t.index(k);
+		}
+		auto summarize(const K& l, const K& r){
+			coder.put_key(_begin(trace_op::summarize), l);
+			coder.put_key(block, r);
+			_end();
+			return t.summarize(l, r);
+		}
+		auto summarize_by_index(size_t l, size_t r){
+			stream_codec_base::put_varint(_begin(trace_op::summarize_by_index), l);
+			stream_codec_base::put_varint(block, r);
+			_end();
+			return t.summarize_by_index(l, r);
+		}
+		// calls f for at most n elements from the first one not less than k, and returns the number of them
+		template<typename F> size_t scan(const K& k, size_t n, F f){
+			coder.put_key(_begin(trace_op::scan), k);
+			stream_codec_base::put_varint(block, n);
+			_end();
+			return avltree_base::scan(t, k, n, f);
+		}
+		
+		// writes the buffered records to os
+		void flush(){
+			if(!block.empty()){
+				const uint32_t size = (uint32_t)block.size();
+				os.write(reinterpret_cast<const char*>(&size), sizeof(size));
+				os.write(block.data(), block.size());
+				block.clear();
+			}
+			os.flush();
+		}
+	};
+	
+	// reads the trace written by traced<>, for trees of type T or others with the same key and value types
+	template<typename T> class trace_reader{
+		using K = typename avltree_base::element_key<T>::type;
+		using V = typename T::value_type;
+		
+		std::istream& is;
+		std::string block;
+		const char* p;
+		const char* e;
+		avltree_base::trace_coder<K, V> coder;
+		bool valid;
+		bool complete;
+		
+		bool _fill(){
+			uint32_t size;
+			if(!is.read(reinterpret_cast<char*>(&size), sizeof(size))){
+				return false;
+			}
+			block.resize(size);
+			if(size == 0 || !is.read(block.data(), size)){
+				complete = false;
+				return false;
+			}
+			p = block.data();
+			e = p + size;
+			return true;
+		}
+	public:
+		struct record{
+			trace_op op;
+			K k{}, k2{};
+			V v{};
+			uint64_t i = 0, j = 0;
+			
+			// runs the operation on t, and returns the number of elements found. operations t does not support are skipped
+			template<typename X> size_t apply(X& t) const{
+				switch(op){
+				case trace_op::insert:
+					if constexpr(X::with_value::value){
+						return t.insert(k, v);
+					}else{
+						return t.insert(k);
+					}
+				case trace_op::remove:
+					return (bool)t.remove(k);
+				case trace_op::pop_first:
+					return (bool)t.pop_first();
+				case trace_op::pop_last:
+					return (bool)t.pop_last();
+				case trace_op::find:
+					return (bool)t.find(k);
+				case trace_op::find_ge:
+					return (bool)t.find_ge(k);
+				case trace_op::find_le:
+					return (bool)t.find_le(k);
+				case trace_op::scan:
+					return avltree_base::scan(t, k, i, [](const auto&){});
+				default:
+					break;
+				}
+				if constexpr(X::with_index::value){
+					switch(op){
+					case trace_op::pop_at:
+						return i < t.size() ? (bool)t.pop_at(i) : 0;
+					case trace_op::at:
+						return i < t.size() ? (bool)t.at(i) : 0;
+					case trace_op::index:
+						return t.index(k);
+					default:
+						break;
+					}
+				}
+				if constexpr(avltree_base::has_summarize<X, K>::value){
+					if(op == trace_op::summarize){
+						t.summarize(k, k2);
+						return 1;
+					}else if constexpr(X::with_index::value){
+						if(op == trace_op::summarize_by_index){
+							t.summarize_by_index(i, j);
+							return 1;
+						}
+					}
+				}
+				return 0;
+			}
+		};
+		
+		explicit trace_reader(std::istream& is_): is(is_), block(), p(nullptr), e(nullptr), coder(), valid(false), complete(true){
+			char magic[4];
+			char with_value;
+			valid = is.read(magic, 4) && std::string_view(magic, 4) == "AVLR" && is.get(with_value) && with_value == (T::with_value::value ? 1 : 0);
+		}
+		
+		// whether the header matched T, and the records were read to the end without any damage
+		inline bool good() const{ return valid && complete; }
+		
+		// reads the next record into r, or returns false at the end of the trace
+		bool next(record& r){
+			if(!valid || (p == e && !_fill())){
+				return false;
+			}
+			r.op = (trace_op)*p ++;
+			bool ok = true;
+			switch(r.op){
+			case trace_op::insert:
+				ok = coder.get_key(p, e, r.k) && (!T::with_value::value || coder.get_value(p, e, r.v));
+				break;
+			case trace_op::remove:
+			case trace_op::find:
+			case trace_op::find_ge:
+			case trace_op::find_le:
+			case trace_op::index:
+				ok = coder.get_key(p, e, r.k);
+				break;
+			case trace_op::pop_first:
+			case trace_op::pop_last:
+				break;
+			case trace_op::pop_at:
+			case trace_op::at:
+				ok = stream_codec_base::get_varint(p, e, r.i);
+				break;
+			case trace_op::summarize:
+				ok = coder.get_key(p, e, r.k) && coder.get_key(p, e, r.k2);
+				break;
+			case trace_op::summarize_by_index:
+				ok = stream_codec_base::get_varint(p, e, r.i) && stream_codec_base::get_varint(p, e, r.j);
+				break;
+			case trace_op::scan:
+				ok = coder.get_key(p, e, r.k) && stream_codec_base::get_varint(p, e, r.i);
+				break;
+			default:
+				ok = false;
+			}
+			if(!ok){
+				valid = complete = false;
+			}
+			return ok;
+		}
+	};
+
+	
+	/*
+		BUFFERED UPDATES : ingest through a sorted buffer merged in batches
+	*/
+	
+	namespace avltree_base{
+		template<typename T> struct is_multiset: std::false_type{};
+		template<typename V, tree_spec S, typename U, typename C> struct is_multiset<multiset<V, S, U, C>>: std::true_type{};
+	}
+	
+	// collects the insertions and the removals of map or set T in a buffer, and applies them to T at once when the buffer is full.
+	// the buffer is a sorted array and a short unsorted tail of about sqrt(capacity) entries, which is merged into the array when full.
+	// lookups and nearest key queries consult both the buffer and the tree without changing them. the others through operator-> apply the buffer first
+	template<typename T> class buffered{
+		static_assert(!avltree_base::is_multiset<T>::value, "buffered is available only for map and set");
+		using K = typename avltree_base::element_key<T>::type;
+		using C = typename T::key_compare;
+	public:
+		using data_type = std::conditional_t<T::with_value::value, std::pair<K, typename T::value_type>, K>;
+		using tree_type = T;
+	private:
+		struct entry{
+			data_type d;
+			bool removed;
+		};
+		T t;
+		// the first sorted entries have unique keys, and at most tail_capacity entries are appended after them
+		std::vector<entry> buffer;
+		std::vector<entry> scratch;
+		size_t sorted;
+		size_t capacity;
+		size_t tail_capacity;
+		
+		inline static const K& _key(const data_type& d){
+			if constexpr(T::with_value::value){
+				return d.first;
+			}else{
+				return d;
+			}
+		}
+		inline static bool _less(const entry& a, const entry& b){ return C()(_key(a.d), _key(b.d)); }
+		// sorts the appended entries and merges them into the sorted ones in one pass through scratch, where the latest one of equal keys remains
+		void _normalize(){
+			if(sorted == buffer.size()){
+				return;
+			}
+			std::stable_sort(buffer.begin() + sorted, buffer.end(), _less);
+			scratch.clear();
+			size_t i = 0;
+			for(size_t j = sorted; j < buffer.size(); j ++){
+				if(j + 1 < buffer.size() && !_less(buffer[j], buffer[j + 1])){
+					continue;
+				}
+				while(i < sorted && _less(buffer[i], buffer[j])){
+					scratch.push_back(std::move(buffer[i ++]));
+				}
+				if(i < sorted && !_less(buffer[j], buffer[i])){
+					i ++;
+				}
+				scratch.push_back(std::move(buffer[j]));
+			}
+			scratch.insert(scratch.end(), std::make_move_iterator(buffer.begin() + i), std::make_move_iterator(buffer.begin() + sorted));
+			buffer.swap(scratch);
+			sorted = buffer.size();
+		}
+		// the latest entry of k in the buffer, or nullptr. the appended entries are searched linearly from the latest one
+		const entry* _lookup(const K& k) const{
+			for(size_t i = buffer.size(); i > sorted; i --){
+				const entry& e = buffer[i - 1];
+				if(!C()(k, _key(e.d)) && !C()(_key(e.d), k)){
+					return &e;
+				}
+			}
+			const auto last = buffer.begin() + sorted;
+			const auto it = std::lower_bound(buffer.begin(), last, k, [](const entry& e, const K& k){ return C()(_key(e.d), k); });
+			return it != last && !C()(k, _key(it->d)) ? &*it : nullptr;
+		}
+		inline void _append(data_type&& d, bool removed){
+			buffer.push_back(entry{std::move(d), removed});
+			if(buffer.size() >= capacity){
+				flush();
+			}else if(buffer.size() - sorted >= tail_capacity){
+				_normalize();
+			}
+		}
+		// whether a is before b in the direction R, i.e. nearer to the bound
+		template<bool R> inline static bool _before(const K& a, const K& b){ return R ? C()(a, b) : C()(b, a); }
+		// whether k is after the bound (R) or before it (!R), or equal to it unless S
+		template<bool R, bool S> inline static bool _beyond(const K& k, const K& bound){ return S ? _before<R>(bound, k) : !_before<R>(k, bound); }
+		// the nearest key in the buffer and the tree after k (R) or before k (!R), which may be equal to k unless S
+		template<bool R, bool S> const K* _nearest_key(const K& k) const{
+			const K* c = nullptr;
+			const auto offer = [&](const K& x){
+				if(!c || _before<R>(x, *c)){
+					c = &x;
+				}
+			};
+			const auto last = buffer.begin() + sorted;
+			if constexpr(R){
+				const auto it = S ? std::upper_bound(buffer.begin(), last, k, [](const K& k, const entry& e){ return C()(k, _key(e.d)); })
+				                  : std::lower_bound(buffer.begin(), last, k, [](const entry& e, const K& k){ return C()(_key(e.d), k); });
+				if(it != last){
+					offer(_key(it->d));
+				}
+			}else{
+				const auto it = S ? std::lower_bound(buffer.begin(), last, k, [](const entry& e, const K& k){ return C()(_key(e.d), k); })
+				                  : std::upper_bound(buffer.begin(), last, k, [](const K& k, const entry& e){ return C()(k, _key(e.d)); });
+				if(it != buffer.begin()){
+					offer(_key((it - 1)->d));
+				}
+			}
+			for(auto it = last; it != buffer.end(); ++ it){
+				if(_beyond<R, S>(_key(it->d), k)){
+					offer(_key(it->d));
+				}
+			}
+			if(const auto n = R ? (S ? t.find_gt(k) : t.find_ge(k)) : (S ? t.find_lt(k) : t.find_le(k))){
+				offer(_key(*n));
+			}
+			return c;
+		}
+		// the nearest element after k (R) or before k (!R), which may be equal to k unless S.
+		// the keys removed in the buffer are skipped, and the buffer takes precedence over the tree for the same key
+		template<bool R, bool S> const data_type* _nearest(const K& k) const{
+			const K* c = _nearest_key<R, S>(k);
+			while(c){
+				if(const entry* e = _lookup(*c)){
+					if(!e->removed){
+						return &e->d;
+					}
+				}else{
+					return &*t.find(*c);
+				}
+				c = _nearest_key<R, true>(*c);
+			}
+			return nullptr;
+		}
+	public:
+		explicit buffered(size_t capacity_ = 1 << 16): t(), buffer(), scratch(), sorted(0), capacity(std::max<size_t>(capacity_, 1)), tail_capacity(std::max<size_t>((size_t)std::sqrt((double)capacity), 1)){
+			buffer.reserve(capacity);
+			scratch.reserve(capacity);
+		}
+		
+		// for map
+		template<typename K_, typename V_> void insert(K_&& k, V_&& v){
+			_append(data_type(std::forward<K_>(k), std::forward<V_>(v)), false);
+		}
+		// for set
+		template<typename V_> void insert(V_&& v){
+			_append(data_type(std::forward<V_>(v)), false);
+		}
+		// the value of a map is default constructed for the removal
+		void remove(const K& k){
+			if constexpr(T::with_value::value){
+				_append(data_type(std::piecewise_construct, std::forward_as_tuple(k), std::forward_as_tuple()), true);
+			}else{
+				_append(data_type(k), true);
+			}
+		}
+		// applies the buffered updates to the tree: the removals one by one, and the insertions at once by insert_batch()
+		void flush(){
+			_normalize();
+			std::vector<data_type> added;
+			added.reserve(buffer.size());
+			for(auto& e: buffer){
+				if(e.removed){
+					t.remove(_key(e.d));
+				}else{
+					added.push_back(std::move(e.d));
+				}
+			}
+			t.insert_batch(std::make_move_iterator(added.begin()), std::make_move_iterator(added.end()));
+			buffer.clear();
+			sorted = 0;
+		}
+		
+		// the element of k, or nullptr. the pointer is valid until the next update
+		const data_type* find(const K& k) const{
+			if(const entry* e = _lookup(k)){
+				return e->removed ? nullptr : &e->d;
+			}
+			const auto n = t.find(k);
+			return n ? &*n : nullptr;
+		}
+		inline bool contains(const K& k) const{ return find(k) != nullptr; }
+		inline const data_type* find_ge(const K& k) const{ return _nearest<true, false>(k); }
+		inline const data_type* find_gt(const K& k) const{ return _nearest<true, true>(k); }
+		inline const data_type* find_le(const K& k) const{ return _nearest<false, false>(k); }
+		inline const data_type* find_lt(const K& k) const{ return _nearest<false, true>(k); }
+		
+		// the summaries after applying the buffer, as those of T
+		template<typename... A> inline auto summarize(const A&... a){
+			flush();
+			return t.summarize(a...);
+		}
+		template<typename... A> inline auto summarize_by_index(const A&... a){
+			flush();
+			return t.summarize_by_index(a...);
+		}
+		
+		// number of the buffered updates
+		inline size_t pending() const{ return buffer.size(); }
+		// the tree after applying the buffer, for the other operations such as size(), at(), index(), summarize() and iteration
+		inline const T* operator->(){
+			flush();
+			return &t;
+		}
+		inline const T& operator*(){
+			flush();
+			return t;
+		}
+	};
+}
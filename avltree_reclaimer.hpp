@@ -0,0 +1,68 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <utility>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// avltree::reclaimer is kept apart from avltree.hpp, so that only its users depend on <thread> and the thread library
+namespace avltree{
+	/*
+		BACKGROUND DESTRUCTION : freeing detached nodes off the threads updating trees
+	*/
+	
+	// destroys the objects passed to dispose(), such as erased_range returned by erase_range(), on its own thread
+	class reclaimer{
+		struct garbage{
+			virtual ~garbage() = default;
+		};
+		template<typename T> struct holder: garbage{
+			T x;
+			inline holder(T&& x_): x(std::move(x_)){}
+		};
+		
+		std::mutex m;
+		std::condition_variable cv;
+		std::vector<std::unique_ptr<garbage>> queue;
+		bool stopping;
+		std::thread worker;
+		
+		void _run(){
+			std::unique_lock<std::mutex> lock(m);
+			while(true){
+				cv.wait(lock, [this]{ return stopping || !queue.empty(); });
+				if(queue.empty()){
+					return;
+				}
+				auto batch = std::move(queue);
+				queue.clear();
+				lock.unlock();
+				batch.clear();
+				lock.lock();
+			}
+		}
+	public:
+		reclaimer(): m(), cv(), queue(), stopping(false), worker([this]{ _run(); }){}
+		// destroys the remaining objects before returning
+		~reclaimer(){
+			{
+				std::lock_guard<std::mutex> lock(m);
+				stopping = true;
+			}
+			cv.notify_one();
+			worker.join();
+		}
+		reclaimer(const reclaimer&) = delete;
+		reclaimer& operator=(const reclaimer&) = delete;
+		
+		template<typename T> void dispose(T x){
+			std::unique_ptr<garbage> g = std::make_unique<holder<T>>(std::move(x));
+			{
+				std::lock_guard<std::mutex> lock(m);
+				queue.push_back(std::move(g));
+			}
+			cv.notify_one();
+		}
+	};
+}
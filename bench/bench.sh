@@ -0,0 +1,3 @@
+c++ -std=c++17 -O2 -DNDEBUG bench_avltree.cpp -o bench_avltree && ./bench_avltree 3 6 > bench_avltree.json
+#clang++ -std=c++17 -O2 -DNDEBUG bench_avltree.cpp -o bench_avltree && ./bench_avltree 3 8 > bench_avltree.json
+c++ -std=c++17 -O2 -DNDEBUG bench_workload.cpp -o bench_workload && ./bench_workload ycsb ycsb.trace 100000 1000000 50 50 0 0 && ./bench_workload replay ycsb.trace > bench_workload.json
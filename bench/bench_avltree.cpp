@@ -0,0 +1,264 @@
+#include <set>
+#include <map>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include <type_traits>
+
+#include "../avltree.hpp"
+#include "bench_util.hpp"
+
+// usage: bench_avltree [min_exp [max_exp]]
+// runs every operation on 10^min_exp .. 10^max_exp elements (default 3 .. 6) and writes JSON lines to stdout
+
+namespace bench{
+	enum class distribution{ sorted, random, zipf };
+	inline const char* name(distribution d){
+		switch(d){
+			case distribution::sorted: return "sorted";
+			case distribution::random: return "random";
+			default:                   return "zipf";
+		}
+	}
+
+	// ids are even, so that id + 1 is never a key and find_ge() always has to move to the next node
+	inline std::vector<uint64_t> make_ids(distribution d, size_t n, std::mt19937_64& rng){
+		std::vector<uint64_t> ids(n);
+		if(d == distribution::zipf){
+			zipfian z(n);
+			for(auto& id: ids){
+				id = (splitmix64(z(rng)) >> 2) << 1;
+			}
+		}else{
+			for(size_t i = 0; i < n; i ++){
+				ids[i] = i * 2;
+			}
+			if(d == distribution::random){
+				std::shuffle(ids.begin(), ids.end(), rng);
+			}
+		}
+		return ids;
+	}
+
+	// string keys are numbers, or urls and paths sharing their heads among a few hosts and directories
+	enum class key_shape{ number, url, path };
+
+	template<typename K> inline K make_key(uint64_t id, key_shape shape = key_shape::number){
+		if constexpr(std::is_same_v<K, std::string>){
+			char buf[64];
+			const unsigned group = (unsigned)(splitmix64(id) % 200);
+			switch(shape){
+				case key_shape::url:  std::snprintf(buf, sizeof(buf), "https://shop%03u.example.com/items/%llu", group, (unsigned long long)id); break;
+				case key_shape::path: std::snprintf(buf, sizeof(buf), "/home/user%03u/documents/%llu.txt", group, (unsigned long long)id); break;
+				default:              std::snprintf(buf, sizeof(buf), "%020llu", (unsigned long long)id); break;
+			}
+			return K(buf);
+		}else{
+			return K(id);
+		}
+	}
+
+	template<typename K> inline const char* key_name(){ return std::is_same_v<K, std::string> ? "string" : "int64_t"; }
+
+	template<typename M, typename = void> struct has_at: std::false_type{};
+	template<typename M> struct has_at<M, std::void_t<decltype(std::declval<const M&>().at(size_t()))>>: std::true_type{};
+	template<typename M, typename K, typename = void> struct has_index: std::false_type{};
+	template<typename M, typename K> struct has_index<M, K, std::void_t<decltype(std::declval<const M&>().index(std::declval<const K&>()))>>: std::true_type{};
+	template<typename M, typename K, typename = void> struct has_summarize: std::false_type{};
+	template<typename M, typename K> struct has_summarize<M, K, std::void_t<decltype(std::declval<M&>().summarize(std::declval<const K&>(), std::declval<const K&>()))>>: std::true_type{};
+
+	template<typename M, typename = void> struct has_relayout: std::false_type{};
+	template<typename M> struct has_relayout<M, std::void_t<decltype(std::declval<M&>().relayout())>>: std::true_type{};
+	
+	template<typename M> struct is_std: std::false_type{};
+	template<typename K, typename V> struct is_std<std::map<K, V>>: std::true_type{};
+	template<typename K> struct is_std<std::set<K>>: std::true_type{};
+
+	template<typename M> struct is_set: std::false_type{};
+	template<typename K> struct is_set<std::set<K>>: std::true_type{};
+	template<typename V, avltree::tree_spec S, typename U, typename C> struct is_set<avltree::set<V, S, U, C>>: std::true_type{};
+
+	struct context{
+		const char* container;
+		const char* spec;
+		const char* key;
+		distribution dist;
+		size_t n;
+		size_t size;
+		key_shape shape = key_shape::number;
+
+		template<typename F> void measure(const char* op, size_t ops, F f){
+			const auto start = clock::now();
+			f();
+			const double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+			std::printf("{\"container\": \"%s\", \"spec\": \"%s\", \"key\": \"%s\", \"distribution\": \"%s\", \"n\": %zu, \"size\": %zu, \"op\": \"%s\", \"ops\": %zu, \"ns_per_op\": %.2f}\n",
+				container, spec, key, name(dist), n, size, op, ops, ops ? ns / ops : 0.0);
+			std::fflush(stdout);
+		}
+	};
+
+	template<typename M, typename K> void run(context ctx){
+		std::mt19937_64 rng(ctx.n);
+		const std::vector<uint64_t> ids = make_ids(ctx.dist, ctx.n, rng);
+		std::vector<K> keys;
+		keys.reserve(ids.size());
+		for(const auto id: ids){
+			keys.push_back(make_key<K>(id, ctx.shape));
+		}
+		// lookups follow the same distribution as the inserted keys
+		const size_t q = std::min<size_t>(ctx.n, 1 << 20);
+		std::vector<K> queries, misses;
+		for(size_t i = 0; i < q; i ++){
+			const uint64_t id = ids[rng() % ids.size()];
+			queries.push_back(make_key<K>(id, ctx.shape));
+			misses.push_back(make_key<K>(id + 1, ctx.shape));
+		}
+
+		M tree;
+		ctx.measure("insert", keys.size(), [&]{
+			for(size_t i = 0; i < keys.size(); i ++){
+				if constexpr(is_set<M>::value){
+					tree.insert(keys[i]);
+				}else if constexpr(is_std<M>::value){
+					tree.emplace(keys[i], int64_t(i));
+				}else{
+					tree.insert(keys[i], int64_t(i));
+				}
+			}
+			ctx.size = tree.size();
+		});
+
+		ctx.measure("find", q, [&]{
+			for(const auto& k: queries){
+				escape(tree.find(k));
+			}
+		});
+		ctx.measure("find_ge", q, [&]{
+			for(const auto& k: misses){
+				if constexpr(is_std<M>::value){
+					escape(tree.lower_bound(k));
+				}else{
+					escape(tree.find_ge(k));
+				}
+			}
+		});
+		ctx.measure("iterate", ctx.size, [&]{
+			for(auto it = tree.begin(); it != tree.end(); ++ it){
+				escape(*it);
+			}
+		});
+		if constexpr(!is_std<M>::value && has_at<M>::value){
+			std::vector<size_t> positions(q);
+			for(auto& i: positions){
+				i = rng() % ctx.size;
+			}
+			ctx.measure("at", q, [&]{
+				for(const auto i: positions){
+					escape(tree.at(i));
+				}
+			});
+		}
+		if constexpr(!is_std<M>::value && has_index<M, K>::value){
+			ctx.measure("index", q, [&]{
+				for(const auto& k: queries){
+					escape(tree.index(k));
+				}
+			});
+		}
+		if constexpr(!is_std<M>::value && has_summarize<M, K>::value){
+			ctx.measure("summarize", q, [&]{
+				for(size_t i = 0; i < q; i ++){
+					const K& a = queries[i];
+					const K& b = queries[q - 1 - i];
+					escape(a < b ? tree.summarize(a, b) : tree.summarize(b, a));
+				}
+			});
+			std::vector<std::pair<size_t, size_t>> ranges(q);
+			for(auto& [l, r]: ranges){
+				l = rng() % ctx.size;
+				r = l + rng() % (ctx.size - l) + 1;
+			}
+			ctx.measure("summarize_by_index", q, [&]{
+				for(const auto& [l, r]: ranges){
+					escape(tree.summarize_by_index(l, r));
+				}
+			});
+		}
+
+		if constexpr(has_relayout<M>::value){
+			// the lookups and the scan again, after the nodes are moved in the order of traversal
+			ctx.measure("relayout", ctx.size, [&]{
+				tree.relayout();
+			});
+			ctx.measure("find_relayout", q, [&]{
+				for(const auto& k: queries){
+					escape(tree.find(k));
+				}
+			});
+			ctx.measure("iterate_relayout", ctx.size, [&]{
+				for(auto it = tree.begin(); it != tree.end(); ++ it){
+					escape(*it);
+				}
+			});
+		}
+		
+		std::shuffle(keys.begin(), keys.end(), rng);
+		ctx.measure("erase", keys.size(), [&]{
+			for(const auto& k: keys){
+				if constexpr(is_std<M>::value){
+					tree.erase(k);
+				}else{
+					tree.remove(k);
+				}
+			}
+		});
+	}
+
+	template<typename K> void run_all(size_t n){
+		using S = avltree::tree_spec;
+		for(const auto d: {distribution::sorted, distribution::random, distribution::zipf}){
+			run<std::map<K, int64_t>, K>                                                       ({"std::map",      "-",            key_name<K>(), d, n, 0});
+			run<avltree::map<K, int64_t, S::simple>, K>                                        ({"avltree::map",  "simple",       key_name<K>(), d, n, 0});
+			run<avltree::map<K, int64_t, S::with_index>, K>                                    ({"avltree::map",  "with_index",   key_name<K>(), d, n, 0});
+			run<avltree::map<K, int64_t, S::with_depth>, K>                                    ({"avltree::map",  "with_depth",   key_name<K>(), d, n, 0});
+			run<avltree::map<K, int64_t, S::with_wavl>, K>                                     ({"avltree::map",  "with_wavl",    key_name<K>(), d, n, 0});
+			run<avltree::map<K, int64_t, S::with_hash_index>, K>                               ({"avltree::map",  "with_hash_index", key_name<K>(), d, n, 0});
+			run<avltree::with_summary_value_sum<avltree::map<K, int64_t, S::with_index>>, K>   ({"avltree::map",  "with_summary", key_name<K>(), d, n, 0});
+			run<std::set<K>, K>                                                                ({"std::set",      "-",            key_name<K>(), d, n, 0});
+			run<avltree::set<K, S::simple>, K>                                                 ({"avltree::set",  "simple",       key_name<K>(), d, n, 0});
+			run<avltree::set<K, S::with_index>, K>                                             ({"avltree::set",  "with_index",   key_name<K>(), d, n, 0});
+		}
+	}
+
+	// string keys with long common heads, where with_key_prefix decides in the nodes unless the first 16 bytes are equal
+	inline void run_prefix(size_t n){
+		using S = avltree::tree_spec;
+		using K = std::string;
+		for(const auto shape: {key_shape::url, key_shape::path}){
+			const char* key = shape == key_shape::url ? "url" : "path";
+			run<std::map<K, int64_t>, K>                           ({"std::map",     "-",               key, distribution::random, n, 0, shape});
+			run<avltree::map<K, int64_t, S::simple>, K>            ({"avltree::map", "simple",          key, distribution::random, n, 0, shape});
+			run<avltree::map<K, int64_t, S::with_key_prefix>, K>   ({"avltree::map", "with_key_prefix", key, distribution::random, n, 0, shape});
+		}
+	}
+}
+
+int main(int argc, char* argv[]){
+	const int min_exp = argc > 1 ? std::atoi(argv[1]) : 3;
+	const int max_exp = argc > 2 ? std::atoi(argv[2]) : std::max(min_exp, 6);
+	for(int e = min_exp; e <= max_exp; e ++){
+		const size_t n = size_t(std::pow(10.0, e));
+		std::cerr << "n = " << n << std::endl;
+		bench::run_all<int64_t>(n);
+		bench::run_all<std::string>(n);
+		bench::run_prefix(n);
+	}
+	return 0;
+}
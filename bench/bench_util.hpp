@@ -0,0 +1,44 @@
+#pragma once
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <algorithm>
+
+namespace bench{
+	using clock = std::chrono::steady_clock;
+
+	template<typename T> inline void escape(const T& x){ asm volatile("" : : "g"(&x) : "memory"); }
+
+	inline uint64_t splitmix64(uint64_t x){
+		x += 0x9E3779B97F4A7C15ull;
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+		return x ^ (x >> 31);
+	}
+
+	// the zipfian generator of YCSB, rank 0 is the most frequent
+	class zipfian{
+		uint64_t n;
+		double theta, zetan, alpha, eta;
+	public:
+		zipfian(uint64_t n_, double theta_ = 0.99): n(n_), theta(theta_), zetan(0){
+			for(uint64_t i = 1; i <= n; i ++){
+				zetan += 1 / std::pow(double(i), theta);
+			}
+			const double zeta2 = 1 + std::pow(0.5, theta);
+			alpha = 1 / (1 - theta);
+			eta = (1 - std::pow(2.0 / n, 1 - theta)) / (1 - zeta2 / zetan);
+		}
+		template<typename R> uint64_t operator()(R& rng){
+			const double u = std::uniform_real_distribution<double>(0, 1)(rng);
+			const double uz = u * zetan;
+			if(uz < 1){
+				return 0;
+			}else if(uz < 1 + std::pow(0.5, theta)){
+				return 1;
+			}
+			return std::min<uint64_t>(n - 1, uint64_t(n * std::pow(eta * u - eta + 1, alpha)));
+		}
+	};
+}
@@ -0,0 +1,124 @@
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#include "../avltree.hpp"
+#include "bench_util.hpp"
+
+// usage:
+//   bench_workload ycsb <trace> [records [operations [read [update [insert [scan]]]]]]
+//     records a synthetic trace: loads records keys, then runs operations on zipfian keys with the given ratios (default 100000 1000000 50 50 0 0)
+//   bench_workload replay <trace>
+//     replays the trace on each spec, and writes the throughput and the latency percentiles as JSON lines to stdout
+// traces recorded with avltree::traced<> in production can be replayed too, if the tree is a map from int64_t to int64_t
+
+namespace bench{
+	using tree_type = avltree::map<int64_t, int64_t, avltree::tree_spec::with_index>;
+
+	int ycsb(const char* path, size_t records, size_t operations, const size_t ratio[4]){
+		std::ofstream os(path, std::ios::binary | std::ios::trunc);
+		if(!os){
+			std::cerr << "cannot open " << path << std::endl;
+			return 1;
+		}
+		avltree::traced<tree_type> tree(os);
+		std::mt19937_64 rng(records);
+		const auto key = [](uint64_t i){ return (int64_t)(splitmix64(i) >> 1); };
+		for(size_t i = 0; i < records; i ++){
+			tree.insert(key(i), (int64_t)i);
+		}
+		zipfian z(records);
+		const size_t total = ratio[0] + ratio[1] + ratio[2] + ratio[3];
+		size_t inserted = records;
+		for(size_t i = 0; i < operations; i ++){
+			// the latest inserted keys are the hottest, as in YCSB workload D
+			const int64_t k = key(inserted - 1 - std::min<uint64_t>(z(rng), inserted - 1));
+			size_t r = total ? rng() % total : 0;
+			if(r < ratio[0]){
+				tree.find(k);
+			}else if((r -= ratio[0]) < ratio[1]){
+				// an update replaces the value, by a removal and an insertion of the same key
+				tree.remove(k);
+				tree.insert(k, (int64_t)i);
+			}else if((r -= ratio[1]) < ratio[2]){
+				tree.insert(key(inserted), (int64_t)i);
+				inserted ++;
+			}else{
+				tree.scan(k, 1 + rng() % 100, [](const auto& d){ escape(d); });
+			}
+		}
+		tree.flush();
+		std::cerr << tree.records() << " records written to " << path << std::endl;
+		return 0;
+	}
+
+	template<typename M> void replay(const char* path, const char* spec){
+		using reader = avltree::trace_reader<M>;
+		std::ifstream is(path, std::ios::binary);
+		reader r(is);
+		std::vector<typename reader::record> records;
+		for(typename reader::record rec; r.next(rec); ){
+			records.push_back(rec);
+		}
+		if(!r.good()){
+			std::cerr << path << " is broken after " << records.size() << " records" << std::endl;
+		}
+		M tree;
+		std::vector<uint32_t> latency(records.size());
+		size_t found = 0;
+		const auto start = clock::now();
+		for(size_t i = 0; i < records.size(); i ++){
+			const auto t0 = clock::now();
+			found += records[i].apply(tree);
+			latency[i] = (uint32_t)std::min<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t0).count(), UINT32_MAX);
+		}
+		const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+		escape(found);
+		std::sort(latency.begin(), latency.end());
+		const auto percentile = [&](double p){ return latency.empty() ? 0 : latency[std::min(latency.size() - 1, (size_t)(p * latency.size()))]; };
+		std::printf("{\"trace\": \"%s\", \"spec\": \"%s\", \"records\": %zu, \"size\": %zu, \"seconds\": %.6f, \"ops_per_sec\": %.0f, \"p50_ns\": %u, \"p90_ns\": %u, \"p99_ns\": %u, \"p999_ns\": %u, \"max_ns\": %u",
+			path, spec, records.size(), (size_t)tree.size(), seconds, seconds > 0 ? records.size() / seconds : 0.0,
+			percentile(0.5), percentile(0.9), percentile(0.99), percentile(0.999), latency.empty() ? 0 : latency.back());
+		if constexpr(avltree::tree_spec_has(M::tree_spec, avltree::tree_spec::with_stats)){
+			const auto& c = tree.counters();
+			std::printf(", \"single_rotations\": %llu, \"double_rotations\": %llu, \"rebalance_steps\": %llu",
+				(unsigned long long)c.single_rotations, (unsigned long long)c.double_rotations, (unsigned long long)c.rebalance_steps);
+		}
+		std::printf("}\n");
+		std::fflush(stdout);
+	}
+}
+
+int main(int argc, char* argv[]){
+	using S = avltree::tree_spec;
+	if(argc >= 3 && std::strcmp(argv[1], "ycsb") == 0){
+		const size_t records = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 100000;
+		const size_t operations = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 1000000;
+		size_t ratio[4] = {50, 50, 0, 0};
+		for(int i = 0; i < 4 && 5 + i < argc; i ++){
+			ratio[i] = std::strtoull(argv[5 + i], nullptr, 10);
+		}
+		return bench::ycsb(argv[2], std::max<size_t>(records, 1), operations, ratio);
+	}else if(argc >= 3 && std::strcmp(argv[1], "replay") == 0){
+		bench::replay<avltree::map<int64_t, int64_t, S::simple>>(argv[2], "simple");
+		bench::replay<avltree::map<int64_t, int64_t, S::with_index>>(argv[2], "with_index");
+		bench::replay<avltree::map<int64_t, int64_t, S::with_depth>>(argv[2], "with_depth");
+		bench::replay<avltree::with_summary_value_sum<avltree::map<int64_t, int64_t, S::with_index>>>(argv[2], "with_summary");
+		bench::replay<avltree::map<int64_t, int64_t, S::with_wavl>>(argv[2], "with_wavl");
+		bench::replay<avltree::with_summary_value_sum<avltree::map<int64_t, int64_t, S::with_index | S::with_wavl>>>(argv[2], "with_summary | with_wavl");
+		// rotation counts of both balancing policies
+		bench::replay<avltree::map<int64_t, int64_t, S::with_stats>>(argv[2], "with_stats");
+		bench::replay<avltree::map<int64_t, int64_t, S::with_wavl | S::with_stats>>(argv[2], "with_wavl | with_stats");
+		return 0;
+	}
+	std::cerr << "usage: " << argv[0] << " ycsb <trace> [records [operations [read [update [insert [scan]]]]]]" << std::endl;
+	std::cerr << "       " << argv[0] << " replay <trace>" << std::endl;
+	return 1;
+}
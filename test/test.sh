@@ -2,3 +2,5 @@
 #c++ -std=c++17 -O2 -DUSE_PYTHON_LIKE_PRINT test_avltree2.cpp && ./a.exe
 clang++ -std=c++17 -O2 -DUSE_PYTHON_LIKE_PRINT test_avltree.cpp && ./a.exe
 clang++ -std=c++17 -O2 -DUSE_PYTHON_LIKE_PRINT test_avltree2.cpp && ./a.exe
+clang++ -std=c++20 -O2 -DUSE_PYTHON_LIKE_PRINT test_avltree.cpp && ./a.exe
+clang++ -std=c++20 -O2 -DUSE_PYTHON_LIKE_PRINT test_avltree2.cpp && ./a.exe
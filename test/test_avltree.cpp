@@ -2,6 +2,7 @@
 #include <map>
 #include <vector>
 #include <random>
+#include <sstream>
 
 class checker;
 #define AVLTREE_DEBUG_CLASS ::checker
@@ -34,12 +35,20 @@ public:
 		auto [dr, cr, fr] = n.r ? check_node<K, V, S>(*n.r) : (tuple<size_t, size_t, bool>)make_tuple(0, 0, false);
 		int b = n.balance();
 		
-		if(b != dl - dr || (b != -1 && b != 0 && b != 1)){
+		if constexpr(avltree::avltree_base::avltree<K, V, S>::with_wavl::value){
+			// rank differences are 1 or 2, leaves have rank 0, and ranks bound heights
+			const int rl = n.l ? n.l->rank : -1;
+			const int rr = n.r ? n.r->rank : -1;
+			if(n.rank - rl < 1 || n.rank - rl > 2 || n.rank - rr < 1 || n.rank - rr > 2 || (!n.l && !n.r && n.rank != 0) || (int)max(dl, dr) > n.rank){
+				cout << "invalid rank: " << n.rank << " <-> (" << rl << ", " << rr << ")" << endl;
+				failed = true;
+			}
+		}else if(b != dl - dr || (b != -1 && b != 0 && b != 1)){
 			cout << "unbalance: " << /*n._k << */ ", " << b << " <-> (" << dl << ", " << dr << ")" << endl;
 			failed = true;
 		}
 		
-		const auto count = cl + cr + 1;
+		const auto count = cl + cr + n.weight();
 		
 		if constexpr(avltree::avltree_base::avltree<K, V, S>::with_index::value){
 			if(count != n.c){
@@ -61,8 +70,66 @@ public:
 				cout << "count mismatch: " << c << " <-> " << t.size() << endl;
 				failed = true;
 			}
+			if constexpr(avltree::avltree_base::avltree<K, V, S>::with_extremes::value){
+				const auto* first = t.root.get();
+				const auto* last = t.root.get();
+				for(; first->l; first = first->l.get());
+				for(; last->r; last = last->r.get());
+				if(t._first != first || t._last != last){
+					cout << "extremes mismatch" << endl;
+					failed = true;
+				}
+			}
+			if constexpr(avltree::avltree_base::avltree<K, V, S>::with_tombstone::value){
+				size_t dead = 0;
+				std::vector<const std::remove_reference_t<decltype(*t.root)>*> todo = {t.root.get()};
+				while(!todo.empty()){
+					const auto n = todo.back();
+					todo.pop_back();
+					if(n){
+						dead += n->dead;
+						todo.push_back(n->l.get());
+						todo.push_back(n->r.get());
+					}
+				}
+				if(dead != t._dead){
+					cout << "tombstone mismatch: " << dead << " <-> " << t._dead << endl;
+					failed = true;
+				}
+			}
+			if constexpr(avltree::avltree_base::avltree<K, V, S>::with_hash_index::value){
+				std::set<const void*> nodes;
+				std::vector<const std::remove_reference_t<decltype(*t.root)>*> todo = {t.root.get()};
+				while(!todo.empty()){
+					const auto n = todo.back();
+					todo.pop_back();
+					if(n){
+						nodes.insert(n);
+						todo.push_back(n->l.get());
+						todo.push_back(n->r.get());
+					}
+				}
+				size_t hashed = 0;
+				bool found = true;
+				for(const auto& e: t._slots){
+					if(e.n){
+						hashed ++;
+						found = found && nodes.count(e.n) && t._hash_find(e.n->key()) == e.n;
+					}
+				}
+				if(hashed != t._hashed || hashed != nodes.size() || !found){
+					cout << "hash index mismatch" << endl;
+					failed = true;
+				}
+			}
 			return !(f || failed);
 		}else{
+			if constexpr(avltree::avltree_base::avltree<K, V, S>::with_extremes::value){
+				if(t._first || t._last){
+					cout << "extremes mismatch" << endl;
+					return false;
+				}
+			}
 			return true;
 		}
 	}
@@ -84,6 +151,10 @@ public:
 	//		std::map<int64_t, int64_t> std_tree;
 			
 			for(int i = 0; i < N; i ++){
+				if(i % 7 == 0){
+					// steps of relayout between the updates
+					tree.relayout_step((i / 7) % 9, 3);
+				}
 				const int64_t x = dist(engine);
 				if(coin(engine) == 0 && std_tree.find(x) != std_tree.end()){
 					std_tree.erase(std_tree.find(x));
@@ -385,6 +456,54 @@ public:
 					}
 				}
 			}
+			const T copied(tree);
+			if(!check_tree(copied) || copied.size() != tree.size() || !std::equal(std_tree.begin(), std_tree.end(), copied.begin(), [](const auto& a, const auto& b){ return a == typename M::value_type(b); })){
+				cout << "copy error" << endl;
+				throw "ERROR";
+			}
+			std::stringstream snapshot;
+			tree.save(snapshot);
+			T loaded;
+			if(!loaded.load(snapshot) || !check_tree(loaded) || loaded.size() != tree.size() || !std::equal(std_tree.begin(), std_tree.end(), loaded.begin(), [](const auto& a, const auto& b){ return a == typename M::value_type(b); })){
+				cout << "snapshot error" << endl;
+				throw "ERROR";
+			}
+			std::stringstream stream;
+			tree.export_stream(stream);
+			T imported;
+			if(!imported.import_stream(stream) || !check_tree(imported) || imported.size() != tree.size() || !std::equal(std_tree.begin(), std_tree.end(), imported.begin(), [](const auto& a, const auto& b){ return a == typename M::value_type(b); })){
+				cout << "stream error" << endl;
+				throw "ERROR";
+			}
+			T relaid(tree);
+			relaid.relayout(2);
+			if(!check_tree(relaid) || relaid.size() != tree.size() || !std::equal(std_tree.begin(), std_tree.end(), relaid.begin(), [](const auto& a, const auto& b){ return a == typename M::value_type(b); })){
+				cout << "relayout error" << endl;
+				throw "ERROR";
+			}
+			if constexpr(!is_multiset::value){
+				// batches overlapping with the tree, with equal keys in themselves. a small one is inserted one by one, and a large one is merged
+				for(const int64_t b: {int64_t(4), N / 4}){
+					T merged(tree);
+					M std_merged(std_tree);
+					std::vector<typename M::value_type> batch;
+					for(int64_t i = 0; i < b; i ++){
+						const int64_t x = dist(engine);
+						if constexpr(T::with_value::value){
+							batch.emplace_back(x, (int64_t)i);
+							std_merged[x] = i;
+						}else{
+							batch.push_back(x);
+							std_merged.insert(x);
+						}
+					}
+					const size_t added = std_merged.size() - std_tree.size();
+					if(merged.insert_batch(batch.begin(), batch.end()) != added || !check_tree(merged) || merged.size() != std_merged.size() || !std::equal(std_merged.begin(), std_merged.end(), merged.begin(), [](const auto& a, const auto& b){ return a == typename M::value_type(b); })){
+						cout << "insert_batch error" << endl;
+						throw "ERROR";
+					}
+				}
+			}
 		}
 		{
 			T tree;
@@ -612,6 +731,26 @@ int main(void){
 	CHECK_MULTISET(int64_t, avltree::tree_spec::with_index, N);
 	CHECK_MULTISET(int64_t, avltree::tree_spec::with_depth, N);
 	CHECK_MULTISET(int64_t, avltree::tree_spec::with_index | avltree::tree_spec::with_depth, N);
+	
+	CHECK_MULTISET(int64_t, avltree::tree_spec::with_multiplicity, N);
+	CHECK_MULTISET(int64_t, avltree::tree_spec::with_multiplicity | avltree::tree_spec::with_index, N);
+	CHECK_MULTISET(int64_t, avltree::tree_spec::with_multiplicity | avltree::tree_spec::with_index | avltree::tree_spec::with_depth, N);
+	
+	CHECK_MAP(int64_t, int64_t, avltree::tree_spec::with_index | avltree::tree_spec::with_generation, N);
+	CHECK_MULTISET(int64_t, avltree::tree_spec::with_index | avltree::tree_spec::with_latency, N);
+	CHECK_MAP(int64_t, int64_t, avltree::tree_spec::with_wavl, N);
+	CHECK_MAP(int64_t, int64_t, avltree::tree_spec::with_index | avltree::tree_spec::with_depth | avltree::tree_spec::with_wavl, N);
+	CHECK_MULTISET(int64_t, avltree::tree_spec::with_index | avltree::tree_spec::with_wavl, N);
+	CHECK_MULTISET(int64_t, avltree::tree_spec::with_multiplicity | avltree::tree_spec::with_index | avltree::tree_spec::with_wavl, N);
+	CHECK_MAP(int64_t, int64_t, avltree::tree_spec::with_index | avltree::tree_spec::with_extremes, N);
+	CHECK_MULTISET(int64_t, avltree::tree_spec::with_extremes, N);
+	CHECK_MAP(int64_t, int64_t, avltree::tree_spec::with_hash_index, N);
+	CHECK_MAP(int64_t, int64_t, avltree::tree_spec::with_index | avltree::tree_spec::with_wavl | avltree::tree_spec::with_hash_index, N);
+	CHECK_SET(int64_t, avltree::tree_spec::with_depth | avltree::tree_spec::with_hash_index, N);
+	CHECK_MULTISET(int64_t, avltree::tree_spec::with_multiplicity | avltree::tree_spec::with_index | avltree::tree_spec::with_wavl | avltree::tree_spec::with_extremes, N);
+	CHECK_MAP(int64_t, int64_t, avltree::tree_spec::with_index | avltree::tree_spec::with_arena, N);
+	CHECK_MAP(int64_t, int64_t, avltree::tree_spec::with_index | avltree::tree_spec::with_tombstone, N);
+	CHECK_SET(int64_t, avltree::tree_spec::with_index | avltree::tree_spec::with_depth | avltree::tree_spec::with_tombstone, N);
 
 	return 0;
 }
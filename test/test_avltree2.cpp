@@ -1,235 +1,1660 @@
-#include <set>
-#include <map>
-#include <vector>
-#include <random>
-
-//class checker;
-//#define AVLTREE_DEBUG_CLASS ::checker
-
-#include "../avltree.hpp"
-
-#include <string>
-#include <vector>
-#include <iostream>
-#include <tuple>
-#ifdef USE_PYTHON_LIKE_PRINT
-#include "print.hpp"
-#else
-template<char SEP = ' ', char END = '\n', class... A> inline void print(A& ...){}
-template<char SEP = ' ', char END = '\n', class... A> inline void printe(A& ...){}
-template<char SEP = ' ', char END = '\n', class... A> inline void printo(A& ...){}
-#define define_print(...)
-#define define_print_with_names(...)
-#define define_to_tuple(...)
-#endif
-
-
-using namespace std;
-
-int main(void){
-	const int N = 500;
-	const int64_t M = 100;
-	std::random_device seed_gen;
-	std::mt19937 engine(0);
-	std::uniform_int_distribution<> dist(0, M);
-	{
-//		avltree::set<int64_t, avltree::tree_spec::with_index>::with_summary_sum::with_summary_prod tree;
-		avltree::with_summary_prod<avltree::with_summary_sum<avltree::set<int64_t, avltree::tree_spec::with_index>>> tree;
-		vector<int64_t> vec;
-		
-		for(int i = 0; i < N; i ++){
-			const int64_t x = dist(engine);
-			const auto y = find(vec.begin(), vec.end(), x);
-			if(y == vec.end()){
-				vec.push_back(x);
-				sort(vec.begin(), vec.end());
-				tree.insert(x);
-			}else{
-				vec.erase(y);
-				tree.remove(x);
-			}
-			for(int j = 0; j < vec.size(); j ++){
-				for(int k = j + 1; k <= vec.size(); k ++){
-					int64_t s1 = 0;
-					int64_t p1 = 1;
-					for(int l = j; l < k; l ++){
-						s1 += vec[l];
-						p1 *= vec[l];
-					}
-					const auto [s2, p2] = tree.summarize_by_index(j, k);
-					if(s1 != s2 || p1 != p2){
-						cout << "ERROR" << endl;
-						print(vec, j, k, s1, p1);
-						print(tree, j, k, s2, p2);
-						return 1;
-					}
-				}
-			}
-			for(int j = 0; j < M; j ++){
-				for(int k = j; k < M; k ++){
-					int64_t s1 = 0;
-					int64_t p1 = 1;
-					for(const auto& v: vec){
-						if(j <= v && v <= k){
-							s1 += v;
-							p1 *= v;
-						}
-					}
-					const auto [s2, p2] = tree.summarize(j, k);
-					if(s1 != s2 || p1 != p2){
-						cout << "ERROR" << endl;
-						print(vec, j, k, s1, p1);
-						print(tree, j, k, s2, p2);
-						return 1;
-					}
-				}
-			}
-		}
-		cout << "set passed with size: " << vec.size() << endl;
-	}
-
-	{
-//		avltree::multiset<int64_t, avltree::tree_spec::with_index>::with_summary_sum::with_summary_prod tree;
-		avltree::with_summary_prod<avltree::with_summary_sum<avltree::multiset<int64_t, avltree::tree_spec::with_index>>> tree;
-		vector<int64_t> vec;
-		
-		for(int i = 0; i < N; i ++){
-			if(vec.size() > 1 && dist(engine) < 20){
-				std::uniform_int_distribution<> d(0, vec.size() - 1);
-				const size_t i = d(engine);
-				tree.remove(vec[i]);
-				vec.erase(vec.begin() + i);
-			}else{
-				const int64_t x = dist(engine);
-				vec.push_back(x);
-				sort(vec.begin(), vec.end());
-				tree.insert(x);
-			}
-			for(int j = 0; j < vec.size(); j ++){
-				for(int k = j + 1; k <= vec.size(); k ++){
-					int64_t s1 = 0;
-					int64_t p1 = 1;
-					for(int l = j; l < k; l ++){
-						s1 += vec[l];
-						p1 *= vec[l];
-					}
-					const auto [s2, p2] = tree.summarize_by_index(j, k);
-					if(s1 != s2 || p1 != p2){
-						cout << "ERROR" << endl;
-						print(vec, j, k, s1, p1);
-						print(tree, j, k, s2, p2);
-						return 1;
-					}
-				}
-			}
-			for(int j = 0; j < M; j ++){
-				for(int k = j; k < M; k ++){
-					int64_t s1 = 0;
-					int64_t p1 = 1;
-					for(const auto& v: vec){
-						if(j <= v && v <= k){
-							s1 += v;
-							p1 *= v;
-						}
-					}
-					const auto [s2, p2] = tree.summarize(j, k);
-					if(s1 != s2 || p1 != p2){
-						cout << "ERROR" << endl;
-						print(vec, j, k, s1, p1);
-						print(tree, j, k, s2, p2);
-						return 1;
-					}
-				}
-			}
-		}
-		cout << "multiset passed with size: " << vec.size() << endl;
-	}
-
-	{
-//		avltree::map<int64_t, int64_t, avltree::tree_spec::with_index>::with_summary_key_sum::with_summary_key_prod::with_summary_value_sum::with_summary_value_prod::with_summary_value_min::with_summary_value_max tree;
-		avltree::with_summary_value_max<avltree::with_summary_value_min<avltree::with_summary_value_prod<avltree::with_summary_value_sum<avltree::with_summary_key_prod<avltree::with_summary_key_sum<avltree::map<int64_t, int64_t, avltree::tree_spec::with_index>>>>>>> tree;
-		map<int64_t, int64_t> values;
-		
-		for(int i = 0; i < N; i ++){
-			const int64_t x = dist(engine);
-			if(values.size() > 1 && values.find(x) != values.end() && dist(engine) < 20){
-				values.erase(x);
-				tree.remove(x);
-			}else{
-				const int64_t y = dist(engine);
-				values[x] = y;
-				tree.insert(x, y);
-			}
-			vector<int64_t> vec1;
-			vector<int64_t> vec2;
-			for(const auto& [k, v]: values){
-				vec1.push_back(k);
-				vec2.push_back(v);
-			}
-			for(int j = 0; j < vec1.size(); j ++){
-				for(int k = j + 1; k <= vec1.size(); k ++){
-					int64_t s1 = 0;
-					int64_t p1 = 1;
-					int64_t s2 = 0;
-					int64_t p2 = 1;
-					int64_t min1 = *min_element(vec2.begin() + j, vec2.begin() + k);
-					int64_t max1 = *max_element(vec2.begin() + j, vec2.begin() + k);
-					for(int l = j; l < k; l ++){
-						s1 += vec1[l];
-						p1 *= vec1[l];
-						s2 += vec2[l];
-						p2 *= vec2[l];
-					}
-					const auto [s3, p3, s4, p4, min2, max2] = tree.summarize_by_index(j, k);
-					if(s1 != s3 || p1 != p3 || s2 != s4 || p2 != p4 || min1 != min2 || max1 != max2){
-						cout << "ERROR" << endl;
-						print(values, j, k, s1, p1, s2, p2);
-						print(tree, j, k, s3, p3, s4, p4);
-						return 1;
-					}else{
-//						print(tree, j, k, s3, p3, s4, p4);
-					}
-				}
-			}
-			for(int j = 0; j < M; j ++){
-				for(int k = j; k < M; k ++){
-					int64_t s1 = 0;
-					int64_t p1 = 1;
-					int64_t s2 = 0;
-					int64_t p2 = 1;
-					int64_t min1 = numeric_limits<int64_t>::max();
-					int64_t max1 = numeric_limits<int64_t>::min();
-					for(const auto& [a, b]: values){
-						if(j <= a && a <= k){
-							s1 += a;
-							p1 *= a;
-							s2 += b;
-							p2 *= b;
-							min1 = min(min1, b);
-							max1 = max(max1, b);
-						}
-					}
-					const auto [s3, p3, s4, p4, min2, max2] = tree.summarize(j, k);
-					if(s1 != s3 || p1 != p3 || s2 != s4 || p2 != p4 || min1 != min2 || max1 != max2){
-						cout << "ERROR" << endl;
-						print(values, j, k, s1, p1, s2, p2);
-						print(tree, j, k, s3, p3, s4, p4);
-						return 1;
-					}else{
-//						print(tree, j, k, s3, p3, s4, p4);
-					}
-				}
-			}
-		}
-		cout << "map passed with size: " << values.size() << endl;
-	}
-	
-//	avltree::with_summary_value_max<avltree::map<tuple<int, int>, tuple<int, int>, avltree::tree_spec::with_index>> t;
-	avltree::map<tuple<int, int>, tuple<int, int>, avltree::tree_spec::with_index> t;
-	t.insert(make_tuple(10, 10), make_tuple(10, 10));
-//	print(t.summarize_by_index(0, 0));
-	
-	
-	return 0;
-}
-
+#include <set>
+#include <map>
+#include <vector>
+#include <random>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <deque>
+#include <numeric>
+#include <algorithm>
+
+//class checker;
+//#define AVLTREE_DEBUG_CLASS ::checker
+
+#include "../avltree.hpp"
+#include "../avltree_reclaimer.hpp"
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <tuple>
+#ifdef USE_PYTHON_LIKE_PRINT
+#include "print.hpp"
+#else
+template<char SEP = ' ', char END = '\n', class... A> inline void print(A& ...){}
+template<char SEP = ' ', char END = '\n', class... A> inline void printe(A& ...){}
+template<char SEP = ' ', char END = '\n', class... A> inline void printo(A& ...){}
+#define define_print(...)
+#define define_print_with_names(...)
+#define define_to_tuple(...)
+#endif
+
+
+using namespace std;
+
+struct counting_compare{
+	inline static size_t count = 0;
+	template<typename T> int compare(const T& a, const T& b) const{
+		count ++;
+		return a < b ? -1 : (b < a ? 1 : 0);
+	}
+};
+
+int main(void){
+	const int N = 500;
+	const int64_t M = 100;
+	std::random_device seed_gen;
+	std::mt19937 engine(0);
+	std::uniform_int_distribution<> dist(0, M);
+	{
+//		avltree::set<int64_t, avltree::tree_spec::with_index>::with_summary_sum::with_summary_prod tree;
+		avltree::with_summary_prod<avltree::with_summary_sum<avltree::set<int64_t, avltree::tree_spec::with_index>>> tree;
+		vector<int64_t> vec;
+		
+		for(int i = 0; i < N; i ++){
+			const int64_t x = dist(engine);
+			const auto y = find(vec.begin(), vec.end(), x);
+			if(y == vec.end()){
+				vec.push_back(x);
+				sort(vec.begin(), vec.end());
+				tree.insert(x);
+			}else{
+				vec.erase(y);
+				tree.remove(x);
+			}
+			for(int j = 0; j < vec.size(); j ++){
+				for(int k = j + 1; k <= vec.size(); k ++){
+					int64_t s1 = 0;
+					int64_t p1 = 1;
+					for(int l = j; l < k; l ++){
+						s1 += vec[l];
+						p1 *= vec[l];
+					}
+					const auto [s2, p2] = tree.summarize_by_index(j, k);
+					if(s1 != s2 || p1 != p2){
+						cout << "ERROR" << endl;
+						print(vec, j, k, s1, p1);
+						print(tree, j, k, s2, p2);
+						return 1;
+					}
+				}
+			}
+			for(int j = 0; j < M; j ++){
+				for(int k = j; k < M; k ++){
+					int64_t s1 = 0;
+					int64_t p1 = 1;
+					for(const auto& v: vec){
+						if(j <= v && v <= k){
+							s1 += v;
+							p1 *= v;
+						}
+					}
+					const auto [s2, p2] = tree.summarize(j, k);
+					if(s1 != s2 || p1 != p2){
+						cout << "ERROR" << endl;
+						print(vec, j, k, s1, p1);
+						print(tree, j, k, s2, p2);
+						return 1;
+					}
+				}
+			}
+		}
+		cout << "set passed with size: " << vec.size() << endl;
+	}
+
+	{
+//		avltree::multiset<int64_t, avltree::tree_spec::with_index>::with_summary_sum::with_summary_prod tree;
+		avltree::with_summary_prod<avltree::with_summary_sum<avltree::multiset<int64_t, avltree::tree_spec::with_index>>> tree;
+		vector<int64_t> vec;
+		
+		for(int i = 0; i < N; i ++){
+			if(vec.size() > 1 && dist(engine) < 20){
+				std::uniform_int_distribution<> d(0, vec.size() - 1);
+				const size_t i = d(engine);
+				tree.remove(vec[i]);
+				vec.erase(vec.begin() + i);
+			}else{
+				const int64_t x = dist(engine);
+				vec.push_back(x);
+				sort(vec.begin(), vec.end());
+				tree.insert(x);
+			}
+			for(int j = 0; j < vec.size(); j ++){
+				for(int k = j + 1; k <= vec.size(); k ++){
+					int64_t s1 = 0;
+					int64_t p1 = 1;
+					for(int l = j; l < k; l ++){
+						s1 += vec[l];
+						p1 *= vec[l];
+					}
+					const auto [s2, p2] = tree.summarize_by_index(j, k);
+					if(s1 != s2 || p1 != p2){
+						cout << "ERROR" << endl;
+						print(vec, j, k, s1, p1);
+						print(tree, j, k, s2, p2);
+						return 1;
+					}
+				}
+			}
+			for(int j = 0; j < M; j ++){
+				for(int k = j; k < M; k ++){
+					int64_t s1 = 0;
+					int64_t p1 = 1;
+					for(const auto& v: vec){
+						if(j <= v && v <= k){
+							s1 += v;
+							p1 *= v;
+						}
+					}
+					const auto [s2, p2] = tree.summarize(j, k);
+					if(s1 != s2 || p1 != p2){
+						cout << "ERROR" << endl;
+						print(vec, j, k, s1, p1);
+						print(tree, j, k, s2, p2);
+						return 1;
+					}
+				}
+			}
+		}
+		cout << "multiset passed with size: " << vec.size() << endl;
+	}
+
+	{
+		avltree::with_summary_prod<avltree::with_summary_sum<avltree::multiset<int64_t, avltree::tree_spec::with_index | avltree::tree_spec::with_multiplicity>>> tree;
+		vector<int64_t> vec;
+		
+		for(int i = 0; i < N; i ++){
+			if(vec.size() > 1 && dist(engine) < 20){
+				std::uniform_int_distribution<> d(0, vec.size() - 1);
+				const size_t i = d(engine);
+				tree.remove(vec[i]);
+				vec.erase(vec.begin() + i);
+			}else{
+				const int64_t x = dist(engine);
+				vec.push_back(x);
+				sort(vec.begin(), vec.end());
+				tree.insert(x);
+			}
+			for(int j = 0; j < vec.size(); j ++){
+				for(int k = j + 1; k <= vec.size(); k ++){
+					int64_t s1 = 0;
+					int64_t p1 = 1;
+					for(int l = j; l < k; l ++){
+						s1 += vec[l];
+						p1 *= vec[l];
+					}
+					const auto [s2, p2] = tree.summarize_by_index(j, k);
+					if(s1 != s2 || p1 != p2){
+						cout << "ERROR" << endl;
+						print(vec, j, k, s1, p1);
+						print(tree, j, k, s2, p2);
+						return 1;
+					}
+				}
+			}
+			for(int j = 0; j < M; j ++){
+				for(int k = j; k < M; k ++){
+					int64_t s1 = 0;
+					int64_t p1 = 1;
+					for(const auto& v: vec){
+						if(j <= v && v <= k){
+							s1 += v;
+							p1 *= v;
+						}
+					}
+					const auto [s2, p2] = tree.summarize(j, k);
+					if(s1 != s2 || p1 != p2){
+						cout << "ERROR" << endl;
+						print(vec, j, k, s1, p1);
+						print(tree, j, k, s2, p2);
+						return 1;
+					}
+				}
+			}
+		}
+		cout << "multiset with multiplicity passed with size: " << vec.size() << endl;
+	}
+
+	{
+//		avltree::map<int64_t, int64_t, avltree::tree_spec::with_index>::with_summary_key_sum::with_summary_key_prod::with_summary_value_sum::with_summary_value_prod::with_summary_value_min::with_summary_value_max tree;
+		avltree::with_summary_value_max<avltree::with_summary_value_min<avltree::with_summary_value_prod<avltree::with_summary_value_sum<avltree::with_summary_key_prod<avltree::with_summary_key_sum<avltree::map<int64_t, int64_t, avltree::tree_spec::with_index>>>>>>> tree;
+		map<int64_t, int64_t> values;
+		
+		for(int i = 0; i < N; i ++){
+			const int64_t x = dist(engine);
+			if(values.size() > 1 && values.find(x) != values.end() && dist(engine) < 20){
+				values.erase(x);
+				tree.remove(x);
+			}else{
+				const int64_t y = dist(engine);
+				values[x] = y;
+				tree.insert(x, y);
+			}
+			vector<int64_t> vec1;
+			vector<int64_t> vec2;
+			for(const auto& [k, v]: values){
+				vec1.push_back(k);
+				vec2.push_back(v);
+			}
+			for(int j = 0; j < vec1.size(); j ++){
+				for(int k = j + 1; k <= vec1.size(); k ++){
+					int64_t s1 = 0;
+					int64_t p1 = 1;
+					int64_t s2 = 0;
+					int64_t p2 = 1;
+					int64_t min1 = *min_element(vec2.begin() + j, vec2.begin() + k);
+					int64_t max1 = *max_element(vec2.begin() + j, vec2.begin() + k);
+					for(int l = j; l < k; l ++){
+						s1 += vec1[l];
+						p1 *= vec1[l];
+						s2 += vec2[l];
+						p2 *= vec2[l];
+					}
+					const auto [s3, p3, s4, p4, min2, max2] = tree.summarize_by_index(j, k);
+					if(s1 != s3 || p1 != p3 || s2 != s4 || p2 != p4 || min1 != min2 || max1 != max2){
+						cout << "ERROR" << endl;
+						print(values, j, k, s1, p1, s2, p2);
+						print(tree, j, k, s3, p3, s4, p4);
+						return 1;
+					}else{
+//						print(tree, j, k, s3, p3, s4, p4);
+					}
+				}
+			}
+			for(int j = 0; j < M; j ++){
+				for(int k = j; k < M; k ++){
+					int64_t s1 = 0;
+					int64_t p1 = 1;
+					int64_t s2 = 0;
+					int64_t p2 = 1;
+					int64_t min1 = numeric_limits<int64_t>::max();
+					int64_t max1 = numeric_limits<int64_t>::min();
+					for(const auto& [a, b]: values){
+						if(j <= a && a <= k){
+							s1 += a;
+							p1 *= a;
+							s2 += b;
+							p2 *= b;
+							min1 = min(min1, b);
+							max1 = max(max1, b);
+						}
+					}
+					const auto [s3, p3, s4, p4, min2, max2] = tree.summarize(j, k);
+					if(s1 != s3 || p1 != p3 || s2 != s4 || p2 != p4 || min1 != min2 || max1 != max2){
+						cout << "ERROR" << endl;
+						print(values, j, k, s1, p1, s2, p2);
+						print(tree, j, k, s3, p3, s4, p4);
+						return 1;
+					}else{
+//						print(tree, j, k, s3, p3, s4, p4);
+					}
+				}
+			}
+		}
+		cout << "map passed with size: " << values.size() << endl;
+	}
+	
+//	avltree::with_summary_value_max<avltree::map<tuple<int, int>, tuple<int, int>, avltree::tree_spec::with_index>> t;
+	avltree::map<tuple<int, int>, tuple<int, int>, avltree::tree_spec::with_index> t;
+	t.insert(make_tuple(10, 10), make_tuple(10, 10));
+//	print(t.summarize_by_index(0, 0));
+	
+	{
+		// transparent comparator: lookups by string_view without constructing std::string
+		avltree::with_summary_value_sum<avltree::map<string, int64_t, avltree::tree_spec::with_index, tuple<>, less<>>> tree;
+		map<string, int64_t, less<>> values;
+		for(int i = 0; i < N; i ++){
+			const string k = to_string(dist(engine));
+			const string_view kv(k);
+			if(values.find(kv) != values.end() && dist(engine) < 30){
+				values.erase(values.find(kv));
+				tree.remove(kv);
+			}else{
+				values[k] = i;
+				tree.insert(k, i);
+			}
+			for(int j = 0; j < M; j ++){
+				const string q = to_string(j);
+				const string_view qv(q);
+				const auto it = values.lower_bound(qv);
+				const auto f = tree.find_ge(qv);
+				if(tree.contains(qv) != (values.find(qv) != values.end()) || (it == values.end()) != !f || (f && f->first != it->first) || (f && tree.index(f->first.c_str()) != (size_t)distance(values.begin(), it))){
+					cout << "ERROR" << endl;
+					print(values, q);
+					return 1;
+				}
+				int64_t s1 = 0;
+				for(auto p = values.lower_bound(qv); p != values.end() && p->first <= "5"; p ++){
+					s1 += p->second;
+				}
+				if(s1 != tree.summarize(qv, string_view("5"))){
+					cout << "ERROR" << endl;
+					print(values, q, s1);
+					return 1;
+				}
+			}
+		}
+		cout << "map with transparent comparator passed with size: " << values.size() << endl;
+	}
+	
+	{
+		// comparisons resolved by the key prefixes cached in the nodes
+		avltree::with_summary_value_sum<avltree::map<string, int64_t, avltree::tree_spec::with_index | avltree::tree_spec::with_key_prefix, tuple<>, less<>>> tree;
+		map<string, int64_t, less<>> values;
+		for(int i = 0; i < N; i ++){
+			const string k = "/usr/share/" + to_string(dist(engine) % 10) + "/" + to_string(dist(engine));
+			const string_view kv(k);
+			if(values.find(kv) != values.end() && dist(engine) < 30){
+				values.erase(values.find(kv));
+				tree.remove(kv);
+			}else{
+				values[k] = i;
+				tree.insert(k, i);
+			}
+			for(int j = 0; j < M; j ++){
+				const string q = "/usr/share/" + to_string(j % 10) + "/" + to_string(j);
+				const string_view qv(q);
+				const auto it = values.lower_bound(qv);
+				const auto f = tree.find_ge(qv);
+				if(tree.contains(qv) != (values.find(qv) != values.end()) || (it == values.end()) != !f || (f && f->first != it->first) || (f && tree.index(f->first.c_str()) != (size_t)distance(values.begin(), it))){
+					cout << "ERROR" << endl;
+					print(values, q);
+					return 1;
+				}
+				int64_t s1 = 0;
+				for(auto p = values.lower_bound(qv); p != values.end() && p->first <= "/usr/share/5"; p ++){
+					s1 += p->second;
+				}
+				if(s1 != tree.summarize(qv, string_view("/usr/share/5"))){
+					cout << "ERROR" << endl;
+					print(values, q, s1);
+					return 1;
+				}
+			}
+		}
+		cout << "map with key prefix passed with size: " << values.size() << endl;
+	}
+	
+	{
+		// pointers to characters are ordered as addresses by std::less, including nullptr
+		static const char text[] = "b\0a";
+		avltree::map<const char*, int> tree;
+		tree.insert(text + 2, 2);
+		tree.insert(nullptr, 0);
+		tree.insert(text, 1);
+		int expected = 0;
+		for(const auto& [k, v]: tree){
+			if(v != expected ++){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+		}
+	}
+	
+	{
+		avltree::multiset<int64_t, avltree::tree_spec::with_index, tuple<>, greater<int64_t>> tree;
+		multiset<int64_t, greater<int64_t>> values;
+		for(int i = 0; i < N; i ++){
+			const int64_t x = dist(engine);
+			values.insert(x);
+			tree.insert(x);
+		}
+		size_t i = 0;
+		for(const auto v: values){
+			if(*tree.at(i) != v || tree.index(v) != (size_t)distance(values.begin(), values.find(v)) || !tree.find_gt(v) != (values.upper_bound(v) == values.end())){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+			i ++;
+		}
+		cout << "multiset with greater passed with size: " << values.size() << endl;
+	}
+	
+	{
+		// user three-way comparator on composite keys: one comparison per visited node
+		using key = tuple<int64_t, int64_t, int64_t>;
+		avltree::map<key, int64_t, avltree::tree_spec::with_index, tuple<>, counting_compare> tree;
+		map<key, int64_t> values;
+		for(int i = 0; i < N; i ++){
+			const key k(dist(engine) % 4, dist(engine), dist(engine) % 8);
+			values[k] = i;
+			tree.insert(k, i);
+		}
+		size_t height = 0;
+		for(size_t n = values.size(); n > 0; n >>= 1){
+			height ++;
+		}
+		height = height * 3 / 2 + 1;
+		for(int i = 0; i < N; i ++){
+			const key k(dist(engine) % 4, dist(engine), dist(engine) % 8);
+			const auto it = values.lower_bound(k);
+			counting_compare::count = 0;
+			const auto f = tree.find_ge(k);
+			if(counting_compare::count > height || (it == values.end()) != !f || (f && f->first != it->first)){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+			counting_compare::count = 0;
+			const auto [g, j] = tree.find_lt_with_index(k);
+			if(counting_compare::count > height || (it == values.begin()) != !g || (g && j != (size_t)distance(values.begin(), it) - 1)){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+		}
+		cout << "map with three-way comparator passed with size: " << values.size() << endl;
+	}
+	
+	{
+		// moving nodes between trees and re-keying them keeps counts and summaries consistent
+		avltree::with_summary_value_sum<avltree::map<int64_t, int64_t, avltree::tree_spec::with_index>> src, dst;
+		map<int64_t, int64_t> src_values, dst_values;
+		for(int i = 0; i < N; i ++){
+			const int64_t k = dist(engine);
+			src.try_emplace(k, i);
+			src_values.try_emplace(k, i);
+		}
+		for(int i = 0; i < N; i ++){
+			const int64_t k = dist(engine);
+			auto n = src.remove(k);
+			if(!n != !src_values.erase(k)){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+			if(n){
+				n.key() = -k;
+				n.value() = i;
+				dst_values.insert_or_assign(-k, i);
+				dst.insert(std::move(n));
+			}
+		}
+		int64_t sum = 0;
+		size_t i = 0;
+		for(const auto& [k, v]: dst_values){
+			sum += v;
+			if(dst.at(i)->first != k || dst.summarize_by_index(0, i + 1) != sum){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+			i ++;
+		}
+		if(src.size() != src_values.size() || dst.size() != dst_values.size()){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		cout << "map node reinsertion passed with size: " << dst_values.size() << endl;
+	}
+	
+	{
+		avltree::with_summary_sum<avltree::multiset<int64_t, avltree::tree_spec::with_index | avltree::tree_spec::with_multiplicity>> src, dst;
+		multiset<int64_t> src_values, dst_values;
+		for(int i = 0; i < N; i ++){
+			const int64_t x = dist(engine) % 64;
+			src.emplace(x);
+			src_values.insert(x);
+		}
+		while(src.size() > 0){
+			auto n = src.pop_first();
+			dst_values.insert(*n);
+			src_values.erase(src_values.begin());
+			dst.insert(std::move(n));
+		}
+		int64_t sum = 0;
+		size_t i = 0;
+		for(const auto v: dst_values){
+			sum += v;
+			if(*dst.at(i) != v || dst.summarize_by_index(0, i + 1) != sum || dst.count(v) != dst_values.count(v)){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+			i ++;
+		}
+		cout << "multiset node reinsertion passed with size: " << dst_values.size() << endl;
+	}
+	
+	{
+		// copies share nothing with the original
+		using tree_type = avltree::with_summary_value_sum<avltree::map<int64_t, int64_t, avltree::tree_spec::with_index>>;
+		tree_type tree;
+		map<int64_t, int64_t> values;
+		for(int i = 0; i < N; i ++){
+			const int64_t k = dist(engine);
+			tree.insert(k, i);
+			values[k] = i;
+		}
+		tree_type copied(tree), assigned;
+		assigned = tree;
+		const auto expected = values;
+		for(int i = 0; i < N; i ++){
+			const int64_t k = dist(engine);
+			tree.remove(k);
+			values.erase(k);
+		}
+		for(tree_type* t: {&copied, &assigned}){
+			int64_t sum = 0;
+			size_t i = 0;
+			for(const auto& [k, v]: expected){
+				sum += v;
+				if(t->at(i)->first != k || t->find(k)->second != v || t->index(k) != i || t->summarize_by_index(0, i + 1) != sum){
+					cout << "ERROR" << endl;
+					return 1;
+				}
+				i ++;
+			}
+			if(t->size() != expected.size()){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+		}
+		if(tree.size() != values.size()){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		cout << "map copy passed with size: " << expected.size() << endl;
+	}
+	
+	{
+		using tree_type = avltree::with_summary_sum<avltree::multiset<int64_t, avltree::tree_spec::with_index | avltree::tree_spec::with_multiplicity>>;
+		tree_type tree, loaded;
+		multiset<int64_t> values;
+		for(int i = 0; i < N; i ++){
+			const int64_t x = dist(engine) % 64;
+			tree.insert(x);
+			values.insert(x);
+		}
+		stringstream snapshot;
+		tree.save(snapshot);
+		const string bytes = snapshot.str();
+		if(!loaded.load(snapshot) || loaded.size() != values.size()){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		int64_t sum = 0;
+		size_t i = 0;
+		for(const auto v: values){
+			sum += v;
+			if(*loaded.at(i) != v || loaded.count(v) != values.count(v) || loaded.summarize_by_index(0, i + 1) != sum){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+			i ++;
+		}
+		// truncated or mismatched snapshots are rejected and leave the tree empty
+		stringstream truncated(bytes.substr(0, bytes.size() - 1));
+		avltree::multiset<int64_t, avltree::tree_spec::with_multiplicity> other_spec;
+		stringstream other(bytes);
+		if(loaded.load(truncated) || loaded.size() != 0 || other_spec.load(other) != true){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		avltree::multiset<int64_t, avltree::tree_spec::with_index> without_multiplicity;
+		stringstream mismatched(bytes);
+		if(without_multiplicity.load(mismatched)){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		cout << "multiset snapshot passed with size: " << values.size() << endl;
+	}
+	
+	{
+		// a snapshot in the reverse order fails at the second record, after which no record is read
+		avltree::set<int64_t, avltree::tree_spec::simple, std::tuple<>, std::greater<int64_t>> reversed;
+		for(int64_t i = 0; i < 100; i ++){
+			reversed.insert(i);
+		}
+		stringstream snapshot;
+		reversed.save(snapshot);
+		avltree::set<int64_t> loaded;
+		if(loaded.load(snapshot) || loaded.size() != 0){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		cout << "reversed snapshot passed" << endl;
+	}
+	
+	{
+		// the image is read in place, as if the file was mapped
+		using tree_type = avltree::with_summary_value_sum<avltree::map<int64_t, int64_t>>;
+		tree_type tree;
+		map<int64_t, int64_t> values;
+		for(int i = 0; i < N; i ++){
+			const int64_t k = dist(engine);
+			tree.insert(k, i);
+			values[k] = i;
+		}
+		stringstream image;
+		tree.save_image(image);
+		const string bytes = image.str();
+		vector<uint64_t> buffer(bytes.size() / sizeof(uint64_t) + 1);
+		memcpy(buffer.data(), bytes.data(), bytes.size());
+		const tree_type::image_view view(buffer.data(), bytes.size());
+		if(!view.valid() || view.size() != values.size() || tree_type::image_view(buffer.data(), bytes.size() - 1).valid()){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		int64_t sum = 0;
+		size_t i = 0;
+		for(const auto& [k, v]: values){
+			sum += v;
+			if(view.find(k)->second != v || view.at(i)->first != k || view.index(k) != i || view.summarize_by_index(0, i + 1) != sum || view.summarize(values.begin()->first, k) != sum){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+			i ++;
+		}
+		for(int i = 0; i < N; i ++){
+			const int64_t k = dist(engine);
+			const auto it = values.lower_bound(k);
+			const auto ge = view.find_ge(k);
+			const auto lt = view.find_lt(k);
+			if(view.contains(k) != values.count(k) || (it == values.end()) != !ge || (ge && ge->first != it->first) || (it == values.begin()) != !lt || (lt && lt->first != prev(it)->first)){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+		}
+		cout << "map image passed with size: " << values.size() << endl;
+	}
+	
+	{
+		// string keys are front coded, and broken chunks are rejected by the checksum
+		avltree::map<string, int64_t, avltree::tree_spec::with_index> tree, imported;
+		map<string, int64_t> values;
+		for(int i = 0; i < N * 20; i ++){
+			const string k = "https://example.com/" + to_string(dist(engine)) + "/" + to_string(i);
+			tree.insert(k, -i);
+			values[k] = -i;
+		}
+		stringstream stream;
+		tree.export_stream(stream);
+		const string bytes = stream.str();
+		if(!imported.import_stream(stream) || imported.size() != values.size()){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		size_t i = 0;
+		for(const auto& [k, v]: values){
+			if(imported.at(i)->first != k || imported.find(k)->second != v){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+			i ++;
+		}
+		string broken = bytes;
+		broken[bytes.size() / 2] ^= 1;
+		stringstream broken_stream(broken);
+		if(imported.import_stream(broken_stream) || imported.size() != 0){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		// a chunk claiming a huge size fails at the end of the stream
+		string huge = bytes;
+		const uint32_t huge_size = 0xfffffff0u;
+		huge.replace(24, sizeof(huge_size), reinterpret_cast<const char*>(&huge_size), sizeof(huge_size));
+		stringstream huge_stream(huge);
+		if(imported.import_stream(huge_stream) || imported.size() != 0){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		// a stream in the reverse order fails at the second record, and the failed records are not used to decode
+		avltree::set<int64_t, avltree::tree_spec::simple, std::tuple<>, std::greater<int64_t>> reversed;
+		for(int64_t x = 0; x < 100; x ++){
+			reversed.insert(x * 1000);
+		}
+		stringstream reversed_stream;
+		reversed.export_stream(reversed_stream);
+		avltree::set<int64_t> reversed_imported;
+		if(reversed_imported.import_stream(reversed_stream) || reversed_imported.size() != 0){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		cout << "map stream passed with size: " << values.size() << endl;
+	}
+	
+	{
+		// recovers from the snapshot and the log, and ignores a torn record at the tail
+		using tree_type = avltree::multiset<int64_t, avltree::tree_spec::with_index | avltree::tree_spec::with_multiplicity>;
+		const string path = "test_avltree2_logged";
+		std::remove((path + ".snapshot").c_str());
+		std::remove((path + ".log").c_str());
+		multiset<int64_t> values;
+		{
+			avltree::logged<tree_type> tree(path, 16, avltree::sync_policy::every_n, 4);
+			for(int i = 0; i < N; i ++){
+				const int64_t x = dist(engine) % 32;
+				if(i == N / 2){
+					tree.checkpoint();
+				}
+				if(i % 3 == 0 && values.count(x)){
+					tree.remove(x);
+					values.erase(values.find(x));
+				}else if(i % 7 == 0 && values.size() > 0){
+					tree.pop_at(values.size() / 2);
+					values.erase(next(values.begin(), values.size() / 2));
+				}else{
+					tree.insert(x);
+					values.insert(x);
+				}
+			}
+			tree.pop_first();
+			values.erase(values.begin());
+		}
+		{
+			ofstream log(path + ".log", ios::binary | ios::app);
+			log.write("\x10\0\0\0torn", 8);
+		}
+		avltree::logged<tree_type> tree(path, 1, avltree::sync_policy::per_commit);
+		size_t i = 0;
+		for(const auto v: values){
+			if(*tree->at(i) != v){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+			i ++;
+		}
+		if(tree.good() || tree->size() != values.size()){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		// damage other than a torn tail fails the recovery, and both files are left as they are
+		for(int64_t x = 0; x < 10; x ++){
+			tree.insert(x);
+		}
+		const auto read_file = [](const string& name){
+			ifstream in(name, ios::binary);
+			stringstream bytes;
+			bytes << in.rdbuf();
+			return bytes.str();
+		};
+		for(const string& damaged_file: {path + ".snapshot", path + ".log"}){
+			const string other_file = damaged_file == path + ".log" ? path + ".snapshot" : path + ".log";
+			const string original = read_file(damaged_file), other = read_file(other_file);
+			// the middle of the snapshot, or the first record of the log after its header and the size and checksum of the record
+			string damaged = original;
+			damaged[damaged_file == path + ".log" ? 20 : damaged.size() / 2] ^= 1;
+			ofstream(damaged_file, ios::binary | ios::trunc) << damaged;
+			bool thrown = false;
+			try{
+				avltree::logged<tree_type> damaged_tree(path);
+			}catch(const std::runtime_error&){
+				thrown = true;
+			}
+			if(!thrown || read_file(damaged_file) != damaged || read_file(other_file) != other){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+			ofstream(damaged_file, ios::binary | ios::trunc) << original;
+		}
+		std::remove((path + ".snapshot").c_str());
+		std::remove((path + ".log").c_str());
+		cout << "logged multiset passed with size: " << values.size() << endl;
+	}
+	
+	{
+		// runs of insertions into a map are replayed at once, and a record claiming a huge size at the tail is torn
+		using tree_type = avltree::map<int64_t, int64_t, avltree::tree_spec::with_index>;
+		const string path = "test_avltree2_logged_map";
+		std::remove((path + ".snapshot").c_str());
+		std::remove((path + ".log").c_str());
+		map<int64_t, int64_t> values;
+		{
+			avltree::logged<tree_type> tree(path, 16);
+			for(int i = 0; i < N; i ++){
+				const int64_t k = dist(engine) % 64;
+				if(i % 11 == 0 && values.count(k)){
+					tree.remove(k);
+					values.erase(k);
+				}else if(i % 13 == 0 && values.size() > 0){
+					tree.pop_at(values.size() / 2);
+					values.erase(next(values.begin(), values.size() / 2));
+				}else{
+					tree.insert(k, (int64_t)i);
+					values[k] = i;
+				}
+			}
+		}
+		{
+			ofstream log(path + ".log", ios::binary | ios::app);
+			log.write("\xf0\xff\xff\xfftorn", 8);
+		}
+		avltree::logged<tree_type> tree(path);
+		if(tree.good() || tree->size() != values.size() || !equal(values.begin(), values.end(), tree->begin(), [](const auto& a, const auto& b){ return a.first == b.first && a.second == b.second; })){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		std::remove((path + ".snapshot").c_str());
+		std::remove((path + ".log").c_str());
+		cout << "logged map passed with size: " << values.size() << endl;
+	}
+	
+	{
+		// a standby tree follows the live one by the deltas only
+		using tree_type = avltree::map<int64_t, int64_t, avltree::tree_spec::with_generation>;
+		tree_type live, standby;
+		for(int i = 0; i < N * 10; i ++){
+			live.insert(dist(engine), i);
+		}
+		stringstream base;
+		live.export_stream(base);
+		standby.import_stream(base);
+		stringstream first;
+		live.checkpoint_delta(first);
+		for(int round = 0; round < 20; round ++){
+			for(int i = 0; i < 10; i ++){
+				const int64_t k = dist(engine);
+				if(i % 2 == 0){
+					live.insert(k, round);
+				}else{
+					live.remove(k);
+				}
+			}
+			if(round % 5 == 0){
+				live.pop_first();
+			}
+			stringstream delta;
+			live.checkpoint_delta(delta);
+			if(!standby.apply_delta(delta) || standby.size() != live.size()){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+			auto it = standby.begin();
+			for(const auto& [k, v]: live){
+				if(it->first != k || it->second != v){
+					cout << "ERROR" << endl;
+					return 1;
+				}
+				++ it;
+			}
+		}
+		{
+			// a range claiming a huge size fails at the end of the stream, and the standby is not changed
+			live.insert(dist(engine), 0);
+			stringstream delta;
+			live.checkpoint_delta(delta);
+			string huge = delta.str();
+			const uint32_t huge_size = 0xfffffff0u;
+			huge.replace(9, sizeof(huge_size), reinterpret_cast<const char*>(&huge_size), sizeof(huge_size));
+			stringstream huge_stream(huge);
+			if(standby.apply_delta(huge_stream) || !standby.apply_delta(delta) || standby.size() != live.size()){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+		}
+		while(live.size() > 0){
+			live.pop_last();
+		}
+		stringstream last;
+		live.checkpoint_delta(last);
+		if(!standby.apply_delta(last) || standby.size() != 0){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		cout << "map delta passed" << endl;
+	}
+	
+	{
+		// equal keys are counted in one node, so the ranges bounded by keys are exact
+		using tree_type = avltree::multiset<int64_t, avltree::tree_spec::with_generation | avltree::tree_spec::with_multiplicity>;
+		tree_type live, standby;
+		for(int i = 0; i < N; i ++){
+			live.insert(dist(engine) % 100);
+		}
+		stringstream base;
+		live.export_stream(base);
+		standby.import_stream(base);
+		stringstream first;
+		live.checkpoint_delta(first);
+		for(int round = 0; round < 20; round ++){
+			for(int i = 0; i < 10; i ++){
+				const int64_t v = dist(engine) % 100;
+				if(i % 2 == 0){
+					live.insert(v);
+					live.insert(v);
+				}else{
+					live.remove(v);
+				}
+			}
+			stringstream delta;
+			live.checkpoint_delta(delta);
+			if(!standby.apply_delta(delta) || standby.size() != live.size()){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+			auto it = standby.begin();
+			for(const auto v: live){
+				if(*it != v || standby.count(v) != live.count(v)){
+					cout << "ERROR" << endl;
+					return 1;
+				}
+				++ it;
+			}
+		}
+		cout << "multiset delta passed with size: " << live.size() << endl;
+	}
+	
+	{
+		avltree::with_summary_sum<avltree::multiset<int64_t, avltree::tree_spec::with_index | avltree::tree_spec::with_multiplicity>> tree;
+		for(int i = 0; i < N * 10; i ++){
+			tree.insert(dist(engine));
+		}
+		const auto usage = tree.memory_usage();
+		const auto st = tree.stats();
+		size_t nodes = 0, path_length = 0;
+		for(size_t d = 0; d < st.depth_histogram.size(); d ++){
+			nodes += st.depth_histogram[d];
+			path_length += st.depth_histogram[d] * (d + 1);
+		}
+		const size_t balanced = st.balance_histogram[0] + st.balance_histogram[1] + st.balance_histogram[2];
+		if(usage.nodes != st.nodes || nodes != st.nodes || balanced != st.nodes || st.nodes > tree.size() || usage.payload_bytes != st.nodes * sizeof(int64_t)){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		// AVL trees are at most about 1.44 times as high as perfectly balanced ones
+		if(st.height < st.optimal_height || st.height * 2 > st.optimal_height * 3 || st.average_path_length < st.optimal_average_path_length || (size_t)(st.average_path_length * st.nodes + 0.5) != path_length){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		cout << "multiset stats passed with height: " << st.height << endl;
+	}
+	
+	{
+		// the heights of the children may differ by more than 1 in a WAVL tree after removals, but the ranks do not
+		avltree::set<int64_t, avltree::tree_spec::with_depth | avltree::tree_spec::with_wavl> tree;
+		for(int i = 0; i < N * 10; i ++){
+			const int64_t v = dist(engine);
+			if(i % 3 == 2){
+				tree.remove(v);
+			}else{
+				tree.insert(v);
+			}
+		}
+		const auto st = tree.stats();
+		if(st.balance_histogram[0] + st.balance_histogram[1] + st.balance_histogram[2] != st.nodes || st.nodes != tree.size()){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		cout << "wavl stats passed with height: " << st.height << endl;
+	}
+	
+	{
+		avltree::with_summary_value_sum<avltree::map<int64_t, int64_t, avltree::tree_spec::with_index | avltree::tree_spec::with_latency>> tree;
+		size_t inserted = 0, removed = 0;
+		for(int i = 0; i < N; i ++){
+			tree.insert(dist(engine), i);
+		}
+		tree.reset_counters();
+		for(int i = 0; i < N; i ++){
+			tree.find(dist(engine));
+		}
+		// one comparison per visited node
+		if(tree.counters().comparisons != tree.counters().nodes_visited || tree.counters().find.total() != (uint64_t)N){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		for(int i = 0; i < N; i ++){
+			const int64_t k = dist(engine);
+			if(i % 2 == 0){
+				inserted += tree.insert(k, i);
+			}else{
+				removed += (bool)tree.remove(k);
+			}
+			tree.summarize_by_index(0, tree.size() / 2);
+		}
+		const auto& c = tree.counters();
+		if(c.allocations != inserted || c.releases != removed || c.insert.total() != (uint64_t)N / 2 || c.remove.total() != (uint64_t)N / 2 || c.summarize.total() != (uint64_t)N){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		stringstream prometheus;
+		c.write_prometheus(prometheus, "test");
+		if(prometheus.str().find("test_releases_total " + to_string(removed) + "\n") == string::npos || prometheus.str().find("test_insert_latency_seconds_count " + to_string(N / 2) + "\n") == string::npos){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		cout << "map counters passed" << endl;
+	}
+	
+	{
+		using M = avltree::with_summary_value_sum<avltree::map<int64_t, int64_t, avltree::tree_spec::with_index>>;
+		stringstream trace;
+		vector<size_t> results;
+		uint64_t records;
+		{
+			avltree::traced<M> tree(trace);
+			for(int i = 0; i < N; i ++){
+				const int64_t k = dist(engine);
+				switch(i % 8){
+				case 0: case 1: case 2: results.push_back(tree.insert(k, i)); break;
+				case 3: results.push_back((bool)tree.remove(k)); break;
+				case 4: results.push_back((bool)tree.find(k)); break;
+				case 5: results.push_back((bool)tree.find_ge(k)); break;
+				case 6: results.push_back(tree.index(k)); break;
+				default: results.push_back(tree.scan(k, 10, [](const auto&){})); break;
+				}
+			}
+			records = tree.records();
+			tree.summarize(0, 100);
+			tree.pop_first();
+			vector<pair<int64_t, int64_t>> expected;
+			for(auto it = tree->begin(); it != tree->end(); ++ it){
+				expected.push_back(*it);
+			}
+			tree.flush();
+			// replaying on a tree of another spec reproduces the same contents and results
+			for(int pass = 0; pass < 2; pass ++){
+				stringstream in(trace.str());
+				avltree::trace_reader<avltree::map<int64_t, int64_t>> reader(in);
+				avltree::map<int64_t, int64_t> replayed;
+				typename avltree::trace_reader<avltree::map<int64_t, int64_t>>::record r;
+				size_t n = 0;
+				while(reader.next(r)){
+					const size_t result = r.apply(replayed);
+					if(n < results.size() && r.op != avltree::trace_op::index && result != results[n]){
+						cout << "ERROR" << endl;
+						return 1;
+					}
+					n ++;
+				}
+				if(!reader.good() || n != records + 2 || !std::equal(expected.begin(), expected.end(), replayed.begin(), [](const auto& a, const auto& b){ return a == pair<int64_t, int64_t>(b); })){
+					cout << "ERROR" << endl;
+					return 1;
+				}
+			}
+		}
+		// the records in a torn block are not replayed
+		stringstream torn(trace.str().substr(0, trace.str().size() - 1));
+		avltree::trace_reader<M> reader(torn);
+		typename avltree::trace_reader<M>::record r;
+		M replayed;
+		while(reader.next(r)){
+			r.apply(replayed);
+		}
+		if(reader.good()){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		cout << "map trace passed with records: " << records << endl;
+	}
+	
+	{
+		// a scan visits all the equal elements of a multiset, from the first one not less than the key
+		stringstream trace;
+		avltree::traced<avltree::multiset<int64_t>> tree(trace);
+		multiset<int64_t> std_tree;
+		for(int i = 0; i < N; i ++){
+			const int64_t v = dist(engine) % 50;
+			tree.insert(v);
+			std_tree.insert(v);
+		}
+		for(int i = 0; i < N; i ++){
+			const int64_t k = dist(engine) % 52 - 1;
+			vector<int64_t> visited;
+			const size_t n = tree.scan(k, 20, [&](const int64_t v){ visited.push_back(v); });
+			const auto first = std_tree.lower_bound(k);
+			const auto last = next(first, min<size_t>(20, distance(first, std_tree.end())));
+			if(n != visited.size() || !std::equal(visited.begin(), visited.end(), first, last) || n != (size_t)distance(first, last)){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+		}
+		cout << "multiset scan passed" << endl;
+	}
+	
+	{
+		avltree::with_summary_value_sum<avltree::map<int64_t, int64_t, avltree::tree_spec::with_index>> tree;
+		map<int64_t, int64_t> std_tree;
+		avltree::reclaimer reclaimer;
+		size_t erased = 0;
+		for(int i = 0; i < N; i ++){
+			for(int j = 0; j < 20; j ++){
+				const int64_t k = dist(engine) * 100 + dist(engine);
+				tree.insert(k, k % 7);
+				std_tree.emplace(k, k % 7);
+			}
+			size_t n = 0, expected;
+			if(i % 2 == 0){
+				const int64_t k_s = dist(engine) * 100, k_e = k_s + dist(engine) * 10;
+				auto r = tree.erase_range(k_s, k_e);
+				r.for_each([&](const pair<int64_t, int64_t>& d){ n += d.first >= k_s && d.first < k_e; });
+				expected = distance(std_tree.lower_bound(k_s), std_tree.lower_bound(k_e));
+				std_tree.erase(std_tree.lower_bound(k_s), std_tree.lower_bound(k_e));
+				erased += r.size();
+				reclaimer.dispose(std::move(r));
+			}else{
+				const size_t i_s = std_tree.empty() ? 0 : dist(engine) * std_tree.size() / M, i_e = i_s + dist(engine) / 10;
+				const auto r = tree.erase_index_range(i_s, i_e);
+				n = r.size();
+				const auto first = next(std_tree.begin(), min(i_s, std_tree.size())), last = next(std_tree.begin(), min(i_e, std_tree.size()));
+				expected = distance(first, last);
+				std_tree.erase(first, last);
+			}
+			if(n != expected || tree.size() != std_tree.size()){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+			// the counts and the summaries stay consistent after splitting and joining
+			int64_t sum = 0;
+			size_t index = 0;
+			for(const auto& [k, v]: std_tree){
+				if(tree.at(index)->first != k){
+					cout << "ERROR" << endl;
+					return 1;
+				}
+				sum += v;
+				index ++;
+			}
+			if(tree.summarize_by_index(0, tree.size()) != sum){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+		}
+		cout << "map range erase passed with erased: " << erased << endl;
+	}
+	
+	{
+		avltree::multiset<int64_t, avltree::tree_spec::with_extremes> tree;
+		multiset<int64_t> std_tree;
+		for(int i = 0; i < N * 20; i ++){
+			const int64_t v = dist(engine);
+			if(v % 3 != 0){
+				tree.push(v);
+				std_tree.insert(v);
+			}else if(v % 2 == 0){
+				const auto n = tree.pop_first();
+				if((bool)n != !std_tree.empty() || (n && *n != *std_tree.begin())){
+					cout << "ERROR" << endl;
+					return 1;
+				}
+				if(n){
+					std_tree.erase(std_tree.begin());
+				}
+			}else{
+				const auto n = tree.pop_last();
+				if((bool)n != !std_tree.empty() || (n && *n != *std_tree.rbegin())){
+					cout << "ERROR" << endl;
+					return 1;
+				}
+				if(n){
+					std_tree.erase(prev(std_tree.end()));
+				}
+			}
+			// the copy finds its own extremes
+			const auto copied = tree;
+			const auto min = copied.peek_min(), max = copied.peek_max();
+			if(std_tree.empty() ? (min || max) : (!min || !max || *min != *std_tree.begin() || *max != *std_tree.rbegin())){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+		}
+		cout << "multiset extremes passed" << endl;
+	}
+	
+	{
+		const size_t capacity = 50;
+		const int64_t span = 40;
+		avltree::window_stats<int64_t> window(capacity, span);
+		deque<pair<int64_t, int64_t>> std_window;
+		int64_t time = 0;
+		for(int i = 0; i < N * 20; i ++){
+			time += dist(engine) % 3;
+			const int64_t v = dist(engine);
+			window.push(v, time);
+			std_window.emplace_back(time, v);
+			while(std_window.size() > capacity || time - std_window.front().first >= span){
+				std_window.pop_front();
+			}
+			vector<int64_t> sorted;
+			for(const auto& [t, x]: std_window){
+				sorted.push_back(x);
+			}
+			sort(sorted.begin(), sorted.end());
+			const size_t n = sorted.size();
+			const size_t drop = n / 10;
+			const int64_t sum = accumulate(sorted.begin() + drop, sorted.end() - drop, (int64_t)0);
+			if(window.size() != n || *window.median() != sorted[(n + 1) / 2 - 1] || *window.quantile(1.0) != sorted.back() || *window.quantile(0.0) != sorted.front()){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+			if(window.rank(v) != (size_t)(lower_bound(sorted.begin(), sorted.end(), v) - sorted.begin()) || window.trimmed_mean(0.1) != (double)sum / (n - drop * 2)){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+		}
+		window.expire(time + span);
+		if(!window.empty() || window->size() != 0){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		cout << "window stats passed" << endl;
+	}
+	
+	{
+		using M = avltree::map<int64_t, int64_t, avltree::tree_spec::with_index | avltree::tree_spec::with_hash_index>;
+		M tree;
+		map<int64_t, int64_t> std_tree;
+		for(int i = 0; i < N * 20; i ++){
+			const int64_t k = dist(engine);
+			switch(i % 5){
+				case 0:
+				case 1:
+					tree.insert(k, i);
+					std_tree[k] = i;
+					break;
+				case 2:
+					tree.remove(k);
+					std_tree.erase(k);
+					break;
+				case 3:
+					if(tree.pop_first()){
+						std_tree.erase(std_tree.begin());
+					}
+					break;
+				default:
+					if(i % 100 == 4){
+						tree.erase_range(k, k + 10);
+						std_tree.erase(std_tree.lower_bound(k), std_tree.lower_bound(k + 10));
+					}else if(i % 100 == 9){
+						// the copied, moved and loaded trees build their own hash indexes
+						const M copied = tree;
+						M moved = std::move(tree);
+						stringstream snapshot;
+						copied.save(snapshot);
+						tree = M();
+						if(!tree.load(snapshot) || moved.size() != tree.size()){
+							cout << "ERROR" << endl;
+							return 1;
+						}
+					}
+			}
+			for(int j = 0; j < 10; j ++){
+				const int64_t q = dist(engine);
+				const auto found = tree.find(q);
+				const auto std_found = std_tree.find(q);
+				if((bool)found != (std_found != std_tree.end()) || (found && found->second != std_found->second) || tree.contains(q) != (bool)found){
+					cout << "ERROR" << endl;
+					return 1;
+				}
+			}
+		}
+		cout << "map hash index passed with capacity: " << tree.hash_index_capacity() << endl;
+	}
+	
+	{
+		// replace() moves the hash entry with the key, whether the node is overwritten in place or moved
+		avltree::multiset<int64_t, avltree::tree_spec::with_hash_index> tree;
+		multiset<int64_t> std_tree;
+		for(int i = 0; i < N; i ++){
+			const int64_t v = dist(engine) * 4;
+			tree.insert(v);
+			std_tree.insert(v);
+		}
+		for(int i = 0; i < N * 20; i ++){
+			const auto it = next(std_tree.begin(), dist(engine) % std_tree.size());
+			const int64_t x = *it;
+			// a small step mostly stays between the neighbors
+			const int64_t v = i % 2 == 0 ? x + 1 : dist(engine) * 4 + 2;
+			if(!tree.replace(x, v)){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+			std_tree.erase(it);
+			std_tree.insert(v);
+			for(const int64_t q: {x, v, (int64_t)dist(engine) * 4}){
+				if(tree.contains(q) != (std_tree.count(q) > 0) || (tree.find(q) && *tree.find(q) != q)){
+					cout << "ERROR" << endl;
+					return 1;
+				}
+			}
+		}
+		cout << "multiset hash index passed" << endl;
+	}
+	
+	{
+		avltree::small<avltree::with_summary_sum<avltree::multiset<int64_t, avltree::tree_spec::with_index>>, 8> tree;
+		multiset<int64_t> std_tree;
+		size_t layout_changes = 0;
+		bool was_small = true;
+		for(int i = 0; i < N * 20; i ++){
+			// grows beyond the inline array and shrinks back to empty in turns
+			if((i / 20) % 2 == 0){
+				const int64_t v = dist(engine) % 20;
+				tree.insert(v);
+				std_tree.insert(v);
+			}else if(!std_tree.empty()){
+				const auto it = next(std_tree.begin(), dist(engine) % std_tree.size());
+				if(!tree.remove(*it) || tree.remove(20)){
+					cout << "ERROR" << endl;
+					return 1;
+				}
+				std_tree.erase(it);
+			}
+			layout_changes += tree.is_small() != was_small;
+			was_small = tree.is_small();
+			const int64_t q = dist(engine) % 22 - 1;
+			const auto lower = std_tree.lower_bound(q), upper = std_tree.upper_bound(q);
+			const int64_t sum = accumulate(lower, std_tree.upper_bound(q + 5), (int64_t)0);
+			if(tree.size() != std_tree.size() || tree.count(q) != std_tree.count(q) || (tree.find_ge(q) ? *tree.find_ge(q) != *lower : lower != std_tree.end())){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+			if((tree.find_lt(q) ? *tree.find_lt(q) != *prev(lower) : lower != std_tree.begin()) || (tree.find_le(q) ? *tree.find_le(q) != *prev(upper) : upper != std_tree.begin())){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+			if(tree.summarize(q, q + 5) != sum || (!std_tree.empty() && *tree.at(std_tree.size() / 2) != *next(std_tree.begin(), std_tree.size() / 2))){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+			// iterates in the same way over the array and the tree
+			auto std_it = std_tree.begin();
+			for(const auto v: tree){
+				if(std_it == std_tree.end() || v != *std_it){
+					cout << "ERROR" << endl;
+					return 1;
+				}
+				++ std_it;
+			}
+			if(std_it != std_tree.end()){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+		}
+		cout << "small multiset passed with layout changes: " << layout_changes << endl;
+	}
+	
+	{
+		using M = avltree::with_summary_value_sum<avltree::map<int64_t, int64_t, avltree::tree_spec::with_index | avltree::tree_spec::with_arena>>;
+		avltree::forest<M> forest;
+		vector<avltree::forest<M>::handle> trees(100);
+		vector<map<int64_t, int64_t>> std_trees(trees.size());
+		static_assert(sizeof(trees[0]) == sizeof(void*), "a handle of forest must be one pointer");
+		static_assert(!avltree::tree_spec_holds_state_out_of_nodes(M::tree_spec), "a forest must accept M");
+		// the count of tombstones is held by the working tree, and would be shared by all trees of a forest
+		static_assert(avltree::tree_spec_holds_state_out_of_nodes(avltree::set<int, avltree::tree_spec::with_arena | avltree::tree_spec::with_index | avltree::tree_spec::with_tombstone>::tree_spec), "a forest must reject with_tombstone");
+		for(int i = 0; i < N * 20; i ++){
+			const size_t t = dist(engine) % trees.size();
+			const int64_t k = dist(engine) % 50;
+			const int op = dist(engine) % 8;
+			auto& std_tree = std_trees[t];
+			if(op < 5){
+				if(forest.insert(trees[t], k, (int64_t)i) != (std_tree.count(k) == 0)){
+					cout << "ERROR" << endl;
+					return 1;
+				}
+				std_tree[k] = i;
+			}else if(op < 7){
+				if(forest.remove(trees[t], k) != (std_tree.erase(k) > 0)){
+					cout << "ERROR" << endl;
+					return 1;
+				}
+			}else if(dist(engine) % 10 == 0){
+				forest.clear(trees[t]);
+				std_tree.clear();
+			}else if(dist(engine) % 10 == 0){
+				forest.modify(trees[t], [](M& tree){ tree.relayout(2); });
+			}else{
+				const auto first = forest.modify(trees[t], [](M& tree){ const auto n = tree.pop_first(); return n ? n->first : -1; });
+				if(first != (std_tree.empty() ? -1 : std_tree.begin()->first)){
+					cout << "ERROR" << endl;
+					return 1;
+				}
+				if(!std_tree.empty()){
+					std_tree.erase(std_tree.begin());
+				}
+			}
+			const int64_t sum = accumulate(std_tree.lower_bound(k), std_tree.upper_bound(k + 10), (int64_t)0, [](int64_t s, const auto& p){ return s + p.second; });
+			if(forest.size(trees[t]) != std_tree.size() || forest.contains(trees[t], k) != (std_tree.count(k) > 0) || forest.modify(trees[t], [&](M& tree){ return tree.summarize(k, k + 10); }) != sum){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+		}
+		size_t nodes = 0;
+		for(size_t t = 0; t < trees.size(); t ++){
+			nodes += std_trees[t].size();
+			const bool same = forest.read(trees[t], [&](const M& tree){
+				auto it = std_trees[t].begin();
+				for(const auto& [k, v]: tree){
+					if(it == std_trees[t].end() || it->first != k || it->second != v){
+						return false;
+					}
+					++ it;
+				}
+				return it == std_trees[t].end();
+			});
+			if(!same){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+		}
+		if(forest.nodes() != nodes){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		// nodes released out of the operations, and nodes of the heap released in them, go back to where they came from
+		const size_t t = dist(engine) % trees.size();
+		for(int64_t k = 0; k < 10; k ++){
+			forest.insert(trees[t], k + 1000, k);
+		}
+		{
+			const auto escaped = forest.modify(trees[t], [](M& tree){ return tree.pop_last(); });
+			const M copied = forest.modify(trees[t], [](M& tree){ return tree; });
+		}
+		M outside;
+		outside.insert(0, 0);
+		forest.modify(trees[t], [&](M&){ outside = M(); });
+		// nested operations on the same forest are rejected, and leave the trees as they are
+		bool thrown = false;
+		try{
+			forest.modify(trees[t], [&](M&){ return forest.size(trees[(t + 1) % trees.size()]) + forest.contains(trees[(t + 1) % trees.size()], 0); });
+		}catch(const std::logic_error&){
+			thrown = true;
+		}
+		// the escaped node and the nodes of the copy stay in the arena
+		if(!thrown || forest.size(trees[t]) != std_trees[t].size() + 9 || forest.nodes() != nodes + 10 + forest.size(trees[t])){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		cout << "forest passed with nodes: " << nodes << endl;
+	}
+	
+	{
+		// the keys and the values are moved into the relaid nodes, and the nodes are allocated once each
+		avltree::map<string, string, avltree::tree_spec::with_index | avltree::tree_spec::with_key_prefix | avltree::tree_spec::with_stats> tree;
+		map<string, string> std_tree;
+		for(int i = 0; i < N; i ++){
+			const string k = "key/" + to_string(dist(engine) % 1000) + string(20, 'k');
+			tree.insert(k, k + string(20, 'v'));
+			std_tree[k] = k + string(20, 'v');
+		}
+		const uint64_t allocations = tree.counters().allocations;
+		tree.relayout();
+		if(tree.counters().allocations != allocations + std_tree.size() || !equal(std_tree.begin(), std_tree.end(), tree.begin(), [](const auto& a, const auto& b){ return a.first == b.first && a.second == b.second; }) || tree.find(std_tree.begin()->first)->second != std_tree.begin()->second){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		cout << "string map relayout passed with size: " << std_tree.size() << endl;
+	}
+	
+	{
+		avltree::buffered<avltree::with_summary_value_sum<avltree::map<int64_t, int64_t, avltree::tree_spec::with_index>>> tree(16);
+		map<int64_t, int64_t> std_tree;
+		size_t flushes = 0;
+		const auto differ = [](const auto* a, const auto& b){ return a->first != b.first || a->second != b.second; };
+		for(int i = 0; i < N * 20; i ++){
+			const int64_t k = dist(engine) % 200;
+			const size_t pending = tree.pending();
+			if(dist(engine) % 3 == 0){
+				tree.remove(k);
+				std_tree.erase(k);
+			}else{
+				tree.insert(k, (int64_t)i);
+				std_tree[k] = i;
+			}
+			flushes += pending > 0 && tree.pending() == 0;
+			const int64_t q = dist(engine) % 202 - 1;
+			const auto found = tree.find(q);
+			const auto std_found = std_tree.find(q);
+			if((found != nullptr) != (std_found != std_tree.end()) || (found && found->second != std_found->second)){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+			const auto ge = tree.find_ge(q), gt = tree.find_gt(q), le = tree.find_le(q), lt = tree.find_lt(q);
+			const auto std_ge = std_tree.lower_bound(q), std_gt = std_tree.upper_bound(q);
+			if((ge ? differ(ge, *std_ge) : std_ge != std_tree.end()) || (gt ? differ(gt, *std_gt) : std_gt != std_tree.end())){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+			if((le ? differ(le, *prev(std_gt)) : std_gt != std_tree.begin()) || (lt ? differ(lt, *prev(std_ge)) : std_ge != std_tree.begin())){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+			if(i % 50 == 0){
+				// reads through the tree apply the buffer first
+				const int64_t sum = accumulate(std_tree.lower_bound(q), std_tree.upper_bound(q + 50), (int64_t)0, [](int64_t s, const auto& p){ return s + p.second; });
+				if(tree.summarize(q, q + 50) != sum || tree.pending() != 0 || tree->size() != std_tree.size() || (!std_tree.empty() && tree->at(std_tree.size() / 2)->first != next(std_tree.begin(), std_tree.size() / 2)->first)){
+					cout << "ERROR" << endl;
+					return 1;
+				}
+			}
+		}
+		cout << "buffered map passed with flushes: " << flushes << endl;
+	}
+	
+	{
+		// keys removed and inserted again in turns, where an insertion revives the dead node of the key
+		avltree::with_summary_value_sum<avltree::map<int64_t, int64_t, avltree::tree_spec::with_index | avltree::tree_spec::with_tombstone>> tree;
+		map<int64_t, int64_t> std_tree;
+		size_t revivals = 0, compactions = 0;
+		for(int i = 0; i < N * 20; i ++){
+			const int64_t k = dist(engine) % 200;
+			const size_t dead = tree.tombstones();
+			if(dist(engine) % 2 == 0){
+				if(tree.remove(k) != (std_tree.erase(k) > 0)){
+					cout << "ERROR" << endl;
+					return 1;
+				}
+				compactions += tree.tombstones() < dead;
+			}else{
+				if(tree.insert(k, (int64_t)i) != (std_tree.count(k) == 0)){
+					cout << "ERROR" << endl;
+					return 1;
+				}
+				std_tree[k] = i;
+				revivals += tree.tombstones() < dead;
+			}
+			const int64_t q = dist(engine) % 202 - 1;
+			const auto ge = tree.find_ge(q), le = tree.find_le(q);
+			const auto std_ge = std_tree.lower_bound(q), std_gt = std_tree.upper_bound(q);
+			if((ge ? std_ge == std_tree.end() || ge->first != std_ge->first : std_ge != std_tree.end()) || (le ? std_gt == std_tree.begin() || le->first != prev(std_gt)->first : std_gt != std_tree.begin())){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+			const int64_t sum = accumulate(std_tree.lower_bound(q), std_tree.upper_bound(q + 50), (int64_t)0, [](int64_t s, const auto& p){ return s + p.second; });
+			if(tree.size() != std_tree.size() || tree.memory_usage().nodes != tree.size() + tree.tombstones() || tree.summarize(q, q + 50) != sum || tree.contains(q) != (std_tree.count(q) > 0) || (std_ge != std_tree.end() && tree.index(std_ge->first) != (size_t)distance(std_tree.begin(), std_ge))){
+				cout << "ERROR" << endl;
+				return 1;
+			}
+		}
+		// the dead nodes in an erased range leave with it
+		tree.erase_range(50, 100);
+		std_tree.erase(std_tree.lower_bound(50), std_tree.lower_bound(100));
+		if(tree.size() != std_tree.size() || tree.memory_usage().nodes != tree.size() + tree.tombstones()){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		// without automatic compaction, the removed nodes stay until compact()
+		tree.set_tombstone_ratio(1);
+		const size_t dead = tree.tombstones();
+		for(int64_t k = 0; k < 200; k += 2){
+			std_tree.erase(k);
+			tree.remove(k);
+		}
+		const size_t kept = tree.tombstones();
+		tree.compact();
+		bool same = kept >= dead && tree.tombstones() == 0 && tree.size() == std_tree.size();
+		auto it = std_tree.begin();
+		for(const auto& [k, v]: tree){
+			same = same && it != std_tree.end() && it->first == k && it->second == v;
+			++ it;
+		}
+		if(!same || it != std_tree.end()){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		cout << "tombstone map passed with revivals: " << revivals << ", compactions: " << compactions << endl;
+	}
+	
+	{
+		// pops relink the neighbors of the removed nodes, which may be dead, and the counts stay exact
+		const auto fuzz = [&](auto tree){
+			map<int64_t, int64_t> std_tree;
+			for(int i = 0; i < N * 20; i ++){
+				const int64_t k = dist(engine) % 200;
+				switch(dist(engine) % 5){
+				case 0:
+				case 1:
+					tree.insert(k, (int64_t)i);
+					std_tree[k] = i;
+					break;
+				case 2:
+					tree.remove(k);
+					std_tree.erase(k);
+					break;
+				case 3:
+					if(!std_tree.empty()){
+						const size_t index = dist(engine) % std_tree.size();
+						const auto n = tree.pop_at(index);
+						const auto it = next(std_tree.begin(), index);
+						if(!n || n->first != it->first){
+							return false;
+						}
+						std_tree.erase(it);
+					}
+					break;
+				default:
+					if(i % 2 == 0 ? (bool)tree.pop_first() : (bool)tree.pop_last()){
+						std_tree.erase(i % 2 == 0 ? std_tree.begin() : prev(std_tree.end()));
+					}
+				}
+				if(tree.size() != std_tree.size()){
+					return false;
+				}
+				if(!std_tree.empty()){
+					const size_t index = dist(engine) % std_tree.size();
+					const auto it = next(std_tree.begin(), index);
+					if(tree.at(index)->first != it->first || tree.index(it->first) != index || tree.summarize_by_index(0, tree.size()) != accumulate(std_tree.begin(), std_tree.end(), (int64_t)0, [](int64_t s, const auto& p){ return s + p.second; })){
+						return false;
+					}
+				}
+			}
+			return true;
+		};
+		using S = avltree::tree_spec;
+		if(!fuzz(avltree::with_summary_value_sum<avltree::map<int64_t, int64_t, S::with_index | S::with_tombstone>>()) || !fuzz(avltree::with_summary_value_sum<avltree::map<int64_t, int64_t, S::with_index | S::with_tombstone | S::with_wavl>>()) || !fuzz(avltree::with_summary_value_sum<avltree::map<int64_t, int64_t, S::with_index | S::with_tombstone | S::with_depth>>())){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		// the wrappers return what remove() of the tree returns
+		using M = avltree::map<int64_t, int64_t, S::with_index | S::with_tombstone>;
+		const string path = "test_avltree2_tombstone";
+		stringstream trace;
+		bool removed;
+		{
+			avltree::logged<M> logged(path);
+			avltree::traced<M> traced(trace);
+			logged.insert(1, 1);
+			traced.insert(1, 1);
+			removed = logged.remove(1) && traced.remove(1) && !logged.remove(1) && !traced.remove(1);
+		}
+		std::remove((path + ".snapshot").c_str());
+		std::remove((path + ".log").c_str());
+		if(!removed){
+			cout << "ERROR" << endl;
+			return 1;
+		}
+		cout << "tombstone pops passed" << endl;
+	}
+	
+	return 0;
+}
+